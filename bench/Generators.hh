@@ -0,0 +1,161 @@
+#ifndef _GENERATORS_HH_
+#define _GENERATORS_HH_
+
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+
+#include "../include/ThreadPool.hh"
+
+/*
+ * Synthetic graphs for the benchmarks. Edges are generated in fixed-size
+ * chunks, each with its own generator seeded from the seed and the chunk
+ * number, so chunks run in parallel and the same seed gives the same graph
+ * for any number of threads. Weights are whole numbers in [1, 100].
+ */
+namespace graph {
+
+  /*
+   * Edges of a generated graph, in the order of the text format
+   */
+  struct EdgeSet {
+    std::string family;
+    size_t nodes;
+    bool directed;
+    std::vector<int> from;
+    std::vector<int> to;
+    std::vector<double> weight;
+
+    EdgeSet() : family(), nodes(0), directed(true), from(), to(), weight() {}
+
+    inline size_t size() const { return from.size(); }
+
+    // Returns the edges in the text format of the graph constructors
+    std::string text() const {
+      std::ostringstream out;
+      out << nodes << " " << from.size() << "\n";
+      for (size_t i = 0; i < from.size(); i++) {
+	out << from[i] << " " << to[i] << " " << weight[i] << "\n";
+      }
+      return out.str();
+    }
+  };
+
+  const size_t GENERATOR_CHUNK = 1 << 16; // edges per seeded chunk
+
+  /*
+   * Fills m edges, calling edge(random, i, from, to) for edge i with the
+   * generator of its chunk
+   */
+  template <class Function>
+  void generateEdges(EdgeSet &set, size_t m, uint64_t seed, ThreadPool &pool, Function edge) {
+    set.from.resize(m);
+    set.to.resize(m);
+    set.weight.resize(m);
+
+    const size_t chunks = (m + GENERATOR_CHUNK - 1) / GENERATOR_CHUNK;
+    pool.parallelFor(0, chunks, [&](size_t b, size_t e, unsigned) {
+	for (size_t c = b; c < e; c++) {
+	  std::seed_seq sequence{ (uint32_t) seed, (uint32_t) (seed >> 32), (uint32_t) c };
+	  std::mt19937_64 random(sequence);
+	  std::uniform_int_distribution<int> weight(1, 100);
+	  for (size_t i = c * GENERATOR_CHUNK; i < std::min(m, (c + 1) * GENERATOR_CHUNK); i++) {
+	    edge(random, i, set.from[i], set.to[i]);
+	    set.weight[i] = weight(random);
+	  }
+	}
+      }, 1);
+  }
+
+  /*
+   * Directed R-MAT (Kronecker) graph of 2^scale nodes and degree * 2^scale
+   * edges with the Graph500 probabilities a = 0.57, b = c = 0.19, whose
+   * degrees are skewed like those of social and web graphs
+   */
+  inline EdgeSet RMAT(unsigned scale, size_t degree, uint64_t seed, ThreadPool &pool) {
+    EdgeSet set;
+    set.family = "rmat";
+    set.nodes = (size_t) 1 << scale;
+
+    generateEdges(set, degree * set.nodes, seed, pool,
+		  [&](std::mt19937_64 &random, size_t, int &from, int &to) {
+	std::uniform_real_distribution<double> quadrant(0.0, 1.0);
+	from = to = 0;
+	for (unsigned bit = 0; bit < scale; bit++) {
+	  double p = quadrant(random);
+	  if (p >= 0.57 + 0.19) { from |= 1 << bit; } // c or d
+	  if ((p >= 0.57 && p < 0.57 + 0.19) || p >= 0.57 + 0.19 + 0.19) { to |= 1 << bit; } // b or d
+	}
+      });
+    return set;
+  }
+
+  /*
+   * Directed Erdős–Rényi G(n, m) graph with edges between uniformly random
+   * distinct nodes
+   */
+  inline EdgeSet ErdosRenyi(size_t n, size_t m, uint64_t seed, ThreadPool &pool) {
+    EdgeSet set;
+    set.family = "erdos-renyi";
+    set.nodes = n;
+
+    generateEdges(set, m, seed, pool, [&](std::mt19937_64 &random, size_t, int &from, int &to) {
+	std::uniform_int_distribution<int> node(0, n - 1);
+	from = node(random);
+	do { to = node(random); } while (to == from && n > 1);
+      });
+    return set;
+  }
+
+  /*
+   * Undirected width x height grid with an edge between every pair of
+   * horizontal and vertical neighbours, like a road network without
+   * shortcuts. Only the weights are random.
+   */
+  inline EdgeSet Grid(size_t width, size_t height, uint64_t seed, ThreadPool &pool) {
+    EdgeSet set;
+    set.family = "grid";
+    set.nodes = width * height;
+    set.directed = false;
+
+    // Horizontal edges come first, row by row, then the vertical ones
+    const size_t horizontal = (width - 1) * height, vertical = width * (height - 1);
+    generateEdges(set, horizontal + vertical, seed, pool,
+		  [&](std::mt19937_64 &, size_t i, int &from, int &to) {
+	if (i < horizontal) {
+	  from = (i / (width - 1)) * width + i % (width - 1);
+	  to = from + 1;
+	}
+	else {
+	  from = i - horizontal;
+	  to = from + width;
+	}
+      });
+    return set;
+  }
+
+  /*
+   * Directed acyclic graph of n nodes and m edges, each from a uniformly
+   * random node to a later one
+   */
+  inline EdgeSet RandomDAG(size_t n, size_t m, uint64_t seed, ThreadPool &pool) {
+    EdgeSet set;
+    set.family = "dag";
+    set.nodes = n;
+
+    generateEdges(set, m, seed, pool, [&](std::mt19937_64 &random, size_t, int &from, int &to) {
+	std::uniform_int_distribution<int> node(0, n - 1);
+	do {
+	  from = node(random);
+	  to = node(random);
+	} while (from == to && n > 1);
+	if (from > to) { std::swap(from, to); }
+      });
+    return set;
+  }
+}
+
+#endif // _GENERATORS_HH_
@@ -0,0 +1,303 @@
+#include "../src/shortest_path.cpp"
+#include "../src/search.cpp"
+#include "../src/sort.cpp"
+#include "../include/StreamingGraph.hh"
+#include "Generators.hh"
+
+#include <chrono>
+#include <memory>
+#include <malloc.h>
+#include <iomanip>
+#include <cmath>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace graph;
+
+typedef chrono::steady_clock Clock;
+
+/*
+ * Settings of a benchmark run, set from the command line
+ */
+struct Options {
+  unsigned scale; // 2^scale nodes in the AdjacencyList graphs
+  size_t degree; // average edges per node
+  uint64_t seed;
+  unsigned reps; // timed runs of every benchmark
+  unsigned threads; // threads of the generators and parallel algorithms
+  unsigned matrixScale; // largest scale of the AdjacencyMatrix graphs
+  unsigned floydScale; // scale of the Floyd-Warshall graphs
+  vector<string> families;
+
+  Options() : scale(14), degree(8), seed(1), reps(5), threads(ThreadPool::hardwareThreads()),
+	      matrixScale(11), floydScale(8), families({ "rmat", "erdos-renyi", "grid", "dag" }) {}
+};
+
+/*
+ * Collects the results of the benchmarks as JSON objects
+ */
+class Report {
+
+private:
+  vector<string> _results;
+
+public:
+  Report() : _results() {}
+
+  // Adds the timings of one benchmark, with extra fields of the form "name": value
+  void add(const EdgeSet &set, const string &graph, const string &algorithm, vector<double> seconds,
+	   const string &extra = "");
+
+  // Writes the settings and every result
+  void print(ostream &out, const Options &opt) const;
+};
+
+// Returns seconds elapsed since start
+static inline double elapsed(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Returns the largest resident set size of the process so far, in kB
+static inline long peakRSS() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Returns the heap memory in use, in kB; unlike the resident set size it
+// shrinks when a graph is freed, so it measures one graph at a time
+static inline long heapKB() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo(); // fields are int, so they wrap past 2 GB
+#endif
+  return (info.uordblks + info.hblkhd) / 1024;
+}
+
+void Report::add(const EdgeSet &set, const string &graph, const string &algorithm,
+		 vector<double> seconds, const string &extra) {
+  sort(seconds.begin(), seconds.end());
+  double median = seconds[seconds.size() / 2];
+  double p99 = seconds[(size_t) ceil(0.99 * seconds.size()) - 1]; // nearest rank
+
+  ostringstream out;
+  out << fixed << setprecision(3)
+      << "{\"family\": \"" << set.family << "\", \"graph\": \"" << graph
+      << "\", \"algorithm\": \"" << algorithm << "\", \"nodes\": " << set.nodes
+      << ", \"edges\": " << set.size() << ", \"reps\": " << seconds.size()
+      << ", \"median_ms\": " << median * 1e3 << ", \"p99_ms\": " << p99 * 1e3
+      << ", \"edges_per_sec\": " << setprecision(0) << set.size() / max(median, 1e-9)
+      << ", \"peak_rss_kb\": " << peakRSS() << extra << "}";
+  _results.push_back(out.str());
+}
+
+void Report::print(ostream &out, const Options &opt) const {
+  out << "{\n  \"config\": {\"scale\": " << opt.scale << ", \"degree\": " << opt.degree
+      << ", \"seed\": " << opt.seed << ", \"reps\": " << opt.reps << ", \"threads\": " << opt.threads
+      << ", \"matrix_scale\": " << opt.matrixScale << ", \"floyd_scale\": " << opt.floydScale << "},\n"
+      << "  \"results\": [\n";
+  for (size_t i = 0; i < _results.size(); i++) {
+    out << "    " << _results[i] << (i + 1 < _results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}" << endl;
+}
+
+/*
+ * Generates a graph of the given family with 2^scale nodes
+ */
+EdgeSet generate(const string &family, unsigned scale, const Options &opt, ThreadPool &pool) {
+  const size_t n = (size_t) 1 << scale;
+  if (family == "rmat") { return RMAT(scale, opt.degree, opt.seed, pool); }
+  if (family == "erdos-renyi") { return ErdosRenyi(n, opt.degree * n, opt.seed, pool); }
+  if (family == "grid") { return Grid((size_t) 1 << (scale - scale / 2), (size_t) 1 << (scale / 2), opt.seed, pool); }
+  if (family == "dag") { return RandomDAG(n, opt.degree * n, opt.seed, pool); }
+  throw invalid_argument("Unknown graph family - " + family);
+}
+
+/*
+ * Times reps runs of fn, the i-th one given the i-th of the sources
+ */
+template <class Function>
+vector<double> timeRuns(const vector<int> &sources, Function fn) {
+  vector<double> seconds;
+  for (int src : sources) {
+    Clock::time_point start = Clock::now();
+    fn(src);
+    seconds.push_back(elapsed(start));
+  }
+  return seconds;
+}
+
+/*
+ * Loads and unloads the graph from its text form, then times the
+ * traversals and shortest path algorithms from random sources
+ */
+template <class Graph_T>
+void benchGraph(const EdgeSet &set, const string &name, const Options &opt, Report &report) {
+  const string text = set.text();
+  vector<double> load, unload;
+  long graphKB = 0;
+
+  for (unsigned r = 0; r < opt.reps; r++) {
+    long before = heapKB();
+    Clock::time_point start = Clock::now();
+    istringstream in(text);
+    unique_ptr<Graph_T> g(new Graph_T(EdgeReader<double>(in, opt.threads), set.directed));
+    load.push_back(elapsed(start));
+    graphKB = heapKB() - before;
+
+    start = Clock::now();
+    g.reset();
+    unload.push_back(elapsed(start));
+  }
+  report.add(set, name, "load", load, ", \"graph_heap_kb\": " + to_string(graphKB));
+  report.add(set, name, "unload", unload);
+
+  istringstream in(text);
+  Graph_T g(EdgeReader<double>(in, opt.threads), set.directed);
+
+  // Sources are drawn from the nodes that have edges; in a DAG only the
+  // first nodes reach much of the graph. A sparse graph may have few such
+  // nodes in range, so the draws are capped and the first nodes present
+  // fill in.
+  vector<int> sources;
+  if (g.size() == 0) { throw invalid_argument("Graph has no nodes - " + set.family); }
+  mt19937 random(opt.seed);
+  uniform_int_distribution<int> pick(0, (set.family == "dag") ? g.size() / 64 : g.size() - 1);
+  for (size_t draws = 0; sources.size() < opt.reps && draws < 100 * opt.reps; draws++) {
+    int id = pick(random);
+    if (g.node(id) != nullptr) { sources.push_back(id); }
+  }
+  for (size_t id = 0; sources.size() < opt.reps && id < g.size(); id++) {
+    if (g.node(id) != nullptr) { sources.push_back(id); }
+  }
+  if (sources.empty()) { throw invalid_argument("Graph has no edges - " + set.family); }
+
+  QueryContext<double> ctx(g.size());
+  report.add(set, name, "BFS", timeRuns(sources, [&](int src) { BFS(g, src, ctx); }));
+  report.add(set, name, "DFS", timeRuns(sources, [&](int src) { DFS(g, src, ctx); }));
+  report.add(set, name, "Dijkstra", timeRuns(sources, [&](int src) { Dijkstra(g, src, ctx); }));
+  report.add(set, name, "BellmanFord", timeRuns(sources, [&](int src) { BellmanFord(g, src, ctx); }));
+  if (set.family == "dag") {
+    report.add(set, name, "TopologicalSort", timeRuns(sources, [&](int) { TopologicalSort<double>(g); }));
+  }
+}
+
+/*
+ * Times the all-pairs shortest paths of a small graph
+ */
+template <class Graph_T>
+void benchFloydWarshall(const EdgeSet &set, const string &name, const Options &opt, Report &report) {
+  istringstream in(set.text());
+  Graph_T g(EdgeReader<double>(in, opt.threads), set.directed);
+  ThreadPool pool(opt.threads);
+  vector<double> dist;
+
+  vector<int> runs(opt.reps, 0);
+  report.add(set, name, "FloydWarshall", timeRuns(runs, [&](int) { FloydWarshall(g, dist, pool); }));
+}
+
+/*
+ * Times a stream of edge updates applied in batches to a streaming graph:
+ * every edge of the set is inserted, then half of them are deleted and
+ * inserted again in random order. The target is a million updates per
+ * second.
+ */
+void benchStreaming(const EdgeSet &set, const Options &opt, Report &report) {
+  const size_t BATCH = 1 << 16; // updates per batch
+
+  vector<EdgeUpdate<double> > updates;
+  updates.reserve(2 * set.size());
+  for (size_t i = 0; i < set.size(); i++) {
+    updates.push_back(EdgeUpdate<double>::insertion(set.from[i], set.to[i], set.weight[i]));
+  }
+  mt19937 random(opt.seed);
+  uniform_int_distribution<size_t> pick(0, max((size_t) 1, set.size()) - 1);
+  for (size_t i = 0; i < set.size() / 2; i++) {
+    size_t e = pick(random);
+    updates.push_back(EdgeUpdate<double>::deletion(set.from[e], set.to[e]));
+    updates.push_back(EdgeUpdate<double>::insertion(set.from[e], set.to[e], set.weight[e]));
+  }
+
+  vector<double> seconds;
+  for (unsigned r = 0; r < opt.reps; r++) {
+    StreamingGraph<double> g(set.nodes, set.directed, opt.threads);
+    Clock::time_point start = Clock::now();
+    for (size_t b = 0; b < updates.size(); b += BATCH) {
+      size_t e = min(b + BATCH, updates.size());
+      g.apply(vector<EdgeUpdate<double> >(updates.begin() + b, updates.begin() + e));
+    }
+    seconds.push_back(elapsed(start));
+  }
+
+  vector<double> sorted(seconds);
+  sort(sorted.begin(), sorted.end());
+  ostringstream extra;
+  extra << fixed << setprecision(0) << ", \"updates\": " << updates.size() << ", \"batch\": " << BATCH
+	<< ", \"updates_per_sec\": " << updates.size() / max(sorted[sorted.size() / 2], 1e-9);
+  report.add(set, "StreamingGraph", "StreamingUpdates", seconds, extra.str());
+}
+
+/*
+ * Runs the benchmarks and writes the results as JSON to standard output
+ *
+ * Usage: graph-bench [--scale s] [--degree d] [--seed x] [--reps r] [--threads t]
+ *                    [--matrix-scale s] [--floyd-scale s] [--family name[,name...]]
+ */
+int main(int argc, char *argv[]) {
+  Options opt;
+  string usage = "Usage: " + string(argv[0]) + " [--scale s] [--degree d] [--seed x] [--reps r]"
+    " [--threads t] [--matrix-scale s] [--floyd-scale s] [--family rmat,erdos-renyi,grid,dag]";
+
+  for (int i = 1; i < argc; i++) {
+    string flag = argv[i];
+    if (i + 1 >= argc) {
+      cerr << usage << endl;
+      return -1;
+    }
+    string value = argv[++i];
+
+    if (flag == "--scale") { opt.scale = stoul(value); }
+    else if (flag == "--degree") { opt.degree = stoul(value); }
+    else if (flag == "--seed") { opt.seed = stoull(value); }
+    else if (flag == "--reps") { opt.reps = max(1ul, stoul(value)); }
+    else if (flag == "--threads") { opt.threads = max(1ul, stoul(value)); }
+    else if (flag == "--matrix-scale") { opt.matrixScale = stoul(value); }
+    else if (flag == "--floyd-scale") { opt.floydScale = stoul(value); }
+    else if (flag == "--family") {
+      opt.families.clear();
+      istringstream names(value);
+      for (string name; getline(names, name, ','); ) { opt.families.push_back(name); }
+    }
+    else {
+      cerr << usage << endl;
+      return -1;
+    }
+  }
+
+  try {
+    ThreadPool pool(opt.threads);
+    Report report;
+
+    for (const string &family : opt.families) {
+      benchGraph<AdjacencyList<double> >(generate(family, opt.scale, opt, pool), "AdjacencyList", opt, report);
+      benchGraph<AdjacencyMatrix<double> >(generate(family, min(opt.scale, opt.matrixScale), opt, pool),
+					   "AdjacencyMatrix", opt, report);
+
+      benchStreaming(generate(family, opt.scale, opt, pool), opt, report);
+
+      EdgeSet small = generate(family, opt.floydScale, opt, pool);
+      benchFloydWarshall<AdjacencyList<double> >(small, "AdjacencyList", opt, report);
+      benchFloydWarshall<AdjacencyMatrix<double> >(small, "AdjacencyMatrix", opt, report);
+    }
+
+    report.print(cout, opt);
+  }
+  catch (const exception &e) {
+    cerr << e.what() << endl;
+    cerr << usage << endl;
+    return -1;
+  }
+  return 0;
+}
@@ -16,6 +16,9 @@
 
 #include "Node.hh"
 #include "Edge.hh"
+#include "Arena.hh"
+#include "EdgeReader.hh"
+#include "CSRGraph.hh"
 
 template <typename T>
 class AdjacencyList;
@@ -28,56 +31,81 @@ bool hasNegativeCycle(const AdjacencyList<T> &g);
 
 /*
  * Describes the adjacency-list structure of representing a 
- * graph data structure
+ * graph data structure. Nodes and edges live in arenas owned by
+ * the graph, and are freed all at once when the graph is destroyed.
  */
 template <typename T>
 class AdjacencyList {
 
+public:
+  typedef std::vector<Edge<T>* > EdgeList;
+
 private:
-  std::map<int, std::list<EdgePtr<T> > > _graph; // uses node ID as key for outgoing edges
+  std::map<int, EdgeList> _graph; // uses node ID as key for outgoing edges
+  std::map<int, EdgeList> _incoming; // uses node ID as key for incoming edges, if tracked
   std::vector<Node<T>* > _nodes; // keeps track of all nodes
+
+  Arena<Node<T> > _nodeArena; // storage of all nodes
+  Arena<Edge<T> > _edgeArena; // storage of all edges
  
   bool _isDirected;
+  bool _trackIncoming; // whether _incoming is maintained
 
-  struct DeleteObject  { 
-    template<typename type> 
-    void operator()(const type *ptr) const { 
-      delete ptr; 
-    } 
+  // Function objects to determine if edge starts or ends at specified node ID
+  struct HasStart { 
+    HasStart(int id) : _id(id) {}
+    int _id;
+    bool operator()(const Edge<T> *e) { 
+      return e->getStart()->getID() == _id;
+    }
   };
-  
-  // Function object to determine if edge has specified node ID
-  struct HasNode : public std::unary_function<int, bool> { 
-    HasNode(int id) : _id(id) {}
+
+  struct HasEnd { 
+    HasEnd(int id) : _id(id) {}
     int _id;
-    bool operator()(EdgePtr<T> e) { 
-      return ((e->getEnd()->getID() == _id) || (e->getStart()->getID() == _id));
+    bool operator()(const Edge<T> *e) { 
+      return e->getEnd()->getID() == _id;
     }
   };
   
   // Function object that resets state and weight of a node
-  struct ResetNode : public std::unary_function<void, void> {
+  struct ResetNode {
     void operator() (Node<T> *n) {
+      if (n == nullptr) { return; } // missing ID
       n->setState(NOT_VISITED);
       n->setWeight(Node<T>::INFINITY);
     }
   };
 
+  // Removes the edges matching pred from a list, returning them to the arena if owned
+  template<class Predicate>
+  void eraseEdges(EdgeList &edges, Predicate pred, bool owned);
+
   AdjacencyList() = delete; // Removes default constructor
 
 public:
-  // Empty graph
-  AdjacencyList(bool directed) : _graph(), _nodes(), _isDirected(directed) {}
+  // Empty graph. With trackIncoming set, the graph also indexes the incoming
+  // edges of every node, which makes inDegree() O(1) and enables incoming()
+  AdjacencyList(bool directed, bool trackIncoming = false)
+    : _graph(), _incoming(), _nodes(), _nodeArena(), _edgeArena(),
+      _isDirected(directed), _trackIncoming(trackIncoming) {}
 
   // Constructs graph from file input of the following format:
   // numNodes numEdges
   // startID endID edgeWeight // Edge 1
   // ...
-  AdjacencyList(std::istream &input, bool directed);
+  AdjacencyList(std::istream &input, bool directed, bool trackIncoming = false)
+    : AdjacencyList(EdgeReader<T>(input), directed, trackIncoming) {}
+
+  // Constructs graph from edges already read, e.g. EdgeReader<T>(filename)
+  AdjacencyList(const EdgeReader<T> &edges, bool directed, bool trackIncoming = false);
+
+  // Graphs own their nodes and edges, so they can be moved but not copied
+  AdjacencyList(AdjacencyList &&other) = default;
   ~AdjacencyList();
   
   // Returns number of nodes
-  inline size_t size() { return _nodes.size(); }
+  inline size_t size() const { return _nodes.size(); }
 
   // Returns node with the specified ID
   inline Node<T> * node(int id) const { return _nodes[id]; }
@@ -85,6 +113,12 @@ public:
   // Returns whether the graph is directed
   inline bool isDirected() const { return _isDirected; }
 
+  // Returns whether incoming edges are indexed
+  inline bool tracksIncoming() const { return _trackIncoming; }
+
+  // Builds the incoming-edge index of an existing graph and keeps it up to date from now on
+  void trackIncoming();
+
   // Connects two existing nodes
   void addEdge(int from, int to, T weight);
   
@@ -99,7 +133,16 @@ public:
   size_t outDegree(const Node<T> *n) const;
 
   // Returns vector of all outgoing edges from a node
-  const std::list<EdgePtr<T> > & adjacent(const Node<T> *n) const;
+  const EdgeList & adjacent(const Node<T> *n) const;
+
+  // Returns vector of all incoming edges to a node; requires the incoming-edge index
+  const EdgeList & incoming(const Node<T> *n) const;
+
+  // Writes a snapshot of the graph, to be loaded with CSRGraph<T>::load()
+  void save(const std::string &path) const { CSRGraph<T>(*this).save(path); }
+
+  // Returns number of bytes held by the node and edge arenas
+  inline size_t arenaBytes() const { return _nodeArena.bytes() + _edgeArena.bytes(); }
   
   // Sets all nodes as not visited with weight INFINITY
   void reset();
@@ -124,40 +167,100 @@ public:
 };
 
 template<typename T>
-AdjacencyList<T>::AdjacencyList(std::istream &input, bool directed) 
-  :  _graph(), _nodes(), _isDirected(directed) {
-  
-  size_t nNodes, nEdges;
-  input >> nNodes >> nEdges;
-  
+AdjacencyList<T>::AdjacencyList(const EdgeReader<T> &edges, bool directed, bool trackIncoming)
+  :  _graph(), _incoming(), _nodes(), _nodeArena(), _edgeArena(),
+     _isDirected(directed), _trackIncoming(trackIncoming) {
+
+  const std::vector<int> &from = edges.from(), &to = edges.to();
+  const std::vector<T> &weight = edges.weight();
+  const size_t nNodes = edges.numNodes();
+
+  // First pass: count the edges of every node that appears in one
+  std::vector<size_t> outDegrees(nNodes, 0), inDegrees(nNodes, 0);
+  std::vector<bool> present(nNodes, false);
+  for (size_t i = 0; i < from.size(); i++) {
+    present[from[i]] = present[to[i]] = true;
+    outDegrees[from[i]]++;
+    inDegrees[to[i]]++;
+    if (!directed) {
+      outDegrees[to[i]]++;
+      inDegrees[from[i]]++;
+    }
+  }
+
+  // Creates the nodes with their lists sized up front
+  std::vector<EdgeList *> out(nNodes, nullptr), in(nNodes, nullptr);
   _nodes.resize(nNodes, nullptr);
+  _nodeArena.reserve(std::count(present.begin(), present.end(), true));
+  for (size_t id = 0; id < nNodes; id++) {
+    if (!present[id]) { continue; }
+    _nodes[id] = _nodeArena.create(id);
+    out[id] = &_graph.insert(_graph.end(), std::make_pair((int) id, EdgeList()))->second;
+    out[id]->reserve(outDegrees[id]);
+    if (_trackIncoming) {
+      in[id] = &_incoming.insert(_incoming.end(), std::make_pair((int) id, EdgeList()))->second;
+      in[id]->reserve(inDegrees[id]);
+    }
+  }
 
-  int from, to; // id's of the two nodes
-  T weight;
-  while (input >> from >> to >> weight) {
-    addNode(from);
-    addNode(to);
-    
-    addEdge(from, to, weight);
+  // Second pass: fill the lists, keeping input order within each node
+  _edgeArena.reserve(directed ? from.size() : 2 * from.size());
+  for (size_t i = 0; i < from.size(); i++) {
+    Edge<T> *e = _edgeArena.create(_nodes[from[i]], _nodes[to[i]], weight[i]);
+    out[from[i]]->push_back(e);
+    if (_trackIncoming) { in[to[i]]->push_back(e); }
+
+    if (!directed) { // adds undirected edge
+      Edge<T> *e_rev = _edgeArena.create(_nodes[to[i]], _nodes[from[i]], weight[i]);
+      out[to[i]]->push_back(e_rev);
+      if (_trackIncoming) { in[from[i]]->push_back(e_rev); }
+    }
   }
 }
 
 template<typename T> 
 AdjacencyList<T>::~AdjacencyList() {
-  for_each(_nodes.begin(), _nodes.end(), DeleteObject());
+  _graph.clear();
+  _incoming.clear();
   _nodes.clear();
+  // arenas release every node and edge at once
+}
 
-  _graph.clear();
+template<typename T>
+template<class Predicate>
+inline void AdjacencyList<T>::eraseEdges(EdgeList &edges, Predicate pred, bool owned) {
+  size_t kept = 0;
+  for (Edge<T> *e : edges) {
+    if (!pred(e)) { edges[kept++] = e; }
+    else if (owned) { _edgeArena.destroy(e); }
+  }
+  edges.resize(kept);
+}
+
+template<typename T>
+void AdjacencyList<T>::trackIncoming() {
+  if (_trackIncoming) { return; }
+
+  _incoming.clear();
+  for (const auto& i : _graph) {
+    _incoming[i.first]; // show that node exists
+    for (auto& edge : i.second) {
+      _incoming[edge->getEnd()->getID()].push_back(edge);
+    }
+  }
+  _trackIncoming = true;
 }
 
 template<typename T>
 inline void AdjacencyList<T>::addEdge(int from, int to, T weight) {
-  Edge<T> *e = new Edge<T>(_nodes[from], _nodes[to] , weight);
-  _graph[from].push_back(EdgePtr<T>(e));
+  Edge<T> *e = _edgeArena.create(_nodes[from], _nodes[to] , weight);
+  _graph[from].push_back(e);
+  if (_trackIncoming) { _incoming[to].push_back(e); }
 
   if (!_isDirected) { // adds undirected edge
-    Edge<T> *e_rev = new Edge<T>(_nodes[to], _nodes[from], weight);
-    _graph[to].push_back(EdgePtr<T>(e_rev));
+    Edge<T> *e_rev = _edgeArena.create(_nodes[to], _nodes[from], weight);
+    _graph[to].push_back(e_rev);
+    if (_trackIncoming) { _incoming[from].push_back(e_rev); }
   }
   else {
     _graph[to]; // show that node exists
@@ -170,35 +273,60 @@ inline void AdjacencyList<T>::addNode(int id) {
     _nodes.resize(id+1, nullptr);
   }
   if (_nodes[id] == nullptr) { // does nothing if node already exists
-    Node<T> *new_node = new Node<T>(id);
+    Node<T> *new_node = _nodeArena.create(id);
     _nodes[id] = new_node;
     _graph[id]; // show that node exists
+    if (_trackIncoming) { _incoming[id]; }
   } 
 }
 
 template<typename T>
 inline void AdjacencyList<T>::removeEdge(int from, int to) {
-  _graph[from].remove_if(HasNode(to));
+  // Incoming lists share the edges, so only the outgoing list frees them
+  if (_trackIncoming) { eraseEdges(_incoming[to], HasStart(from), false); }
+  eraseEdges(_graph[from], HasEnd(to), true);
+
   if (!_isDirected) {
-    _graph[to].remove_if(HasNode(from));
+    if (_trackIncoming) { eraseEdges(_incoming[from], HasStart(to), false); }
+    eraseEdges(_graph[to], HasEnd(from), true);
   }
 }
 
 template<typename T>
 inline void AdjacencyList<T>::removeNode(int id) {
-  if (!_isDirected) {
-    for (auto& edge : _graph[id]) {
-       removeEdge(edge->getEnd()->getID(), id);
-    }
+  if (id < 0 || id >= (int) _nodes.size() || _nodes[id] == nullptr) { return; } // if node doesn't exist
+
+  // Collects the nodes with edges into id before touching any list
+  std::vector<int> sources;
+  if (_trackIncoming) {
+    for (auto& edge : _incoming[id]) { sources.push_back(edge->getStart()->getID()); }
   }
+  else if (!_isDirected) { // every edge into id has a reverse edge out of it
+    for (auto& edge : _graph[id]) { sources.push_back(edge->getEnd()->getID()); }
+  }
+  else {
+    for (const auto& i : _graph) { sources.push_back(i.first); }
+  }
+
+  for (int source : sources) {
+    if (source != id) { eraseEdges(_graph[source], HasEnd(id), true); }
+  }
+  for (auto& edge : _graph[id]) {
+    int target = edge->getEnd()->getID();
+    if (_trackIncoming && target != id) { eraseEdges(_incoming[target], HasStart(id), false); }
+    _edgeArena.destroy(edge);
+  }
+  _incoming.erase(id);
   _graph.erase(id);
 
-  delete _nodes[id]; // frees memory allocated by node
+  _nodeArena.destroy(_nodes[id]); // returns the node's slot to the arena
   _nodes[id] = nullptr;
 }
 
 template<typename T>
 inline size_t AdjacencyList<T>::inDegree(const Node<T> *n) const {
+  if (_trackIncoming) { return incoming(n).size(); }
+
   size_t deg = 0;
   for (const auto& i : _graph) {
     for (auto& edge : i.second) {
@@ -212,18 +340,30 @@ inline size_t AdjacencyList<T>::inDegree(const Node<T> *n) const {
 
 template<typename T>
 inline size_t AdjacencyList<T>::outDegree(const Node<T> *n) const {
-  return _graph[n->getID()].size();
+  return adjacent(n).size();
 }
 
 template<typename T>
-inline const std::list<EdgePtr<T> > & AdjacencyList<T>::adjacent(const Node<T> *n) const {
-  typename std::map<int, std::list<EdgePtr<T> > >::const_iterator iter = _graph.find(n->getID());
+inline const typename AdjacencyList<T>::EdgeList & AdjacencyList<T>::adjacent(const Node<T> *n) const {
+  typename std::map<int, EdgeList>::const_iterator iter = _graph.find(n->getID());
   if (iter == _graph.end()) {
     throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
   }
   return iter->second;
 }
 
+template<typename T>
+inline const typename AdjacencyList<T>::EdgeList & AdjacencyList<T>::incoming(const Node<T> *n) const {
+  if (!_trackIncoming) {
+    throw std::logic_error("Incoming edges are not tracked");
+  }
+  typename std::map<int, EdgeList>::const_iterator iter = _incoming.find(n->getID());
+  if (iter == _incoming.end()) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
+  }
+  return iter->second;
+}
+
 template<typename T>
 inline void AdjacencyList<T>::reset() {
   for_each (_nodes.begin(), _nodes.end(), ResetNode()); 
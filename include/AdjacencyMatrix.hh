@@ -7,13 +7,19 @@
 #include <set>
 #include <string>
 #include <algorithm>
+#include <iterator>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 #include "Node.hh"
 #include "Edge.hh"
+#include "Arena.hh"
+#include "EdgeReader.hh"
+#include "CSRGraph.hh"
 
 
 template <typename T>
@@ -27,68 +33,180 @@ bool hasNegativeCycle(const AdjacencyMatrix<T> &g);
 
 /*
  * Descrives the adjacency-matrix representation of the graph
- * data structure
+ * data structure. Edges are bits in a presence bitset next to a
+ * contiguous array of weights, and adjacent() walks a row of bits
+ * without allocating.
  */
 template <typename T>
 class AdjacencyMatrix {
 
 private:
-  std::vector<std::vector<EdgePtr<T> > > _graph; // array that uses node ID as indices
+  // Row i of a presence bitset is _words 64-bit words; bit j is set if edge (i, j) exists
+  std::vector<uint64_t> _present; // rows use node ID of the start node
+  std::vector<uint64_t> _presentT; // transposed, rows use node ID of the end node, if incoming edges are tracked
+  std::vector<T> _weights; // weight of edge (i, j) at i * size() + j, valid when present
+  size_t _words; // words per bitset row
+
   std::vector<Node<T>* > _nodes; // keeps track of all nodes
+  Arena<Node<T> > _nodeArena; // storage of all nodes
+  std::vector<size_t> _inDegrees; // uses node ID as indices, if incoming edges are tracked
   
   bool _isDirected;
+  bool _trackIncoming; // whether _presentT and _inDegrees are maintained
   
- 
-  struct DeleteObject  { 
-    template<typename type> 
-    void operator()(const type *ptr) const { 
-      delete ptr; 
-    } 
-  };
   
   // Function object that resets state and weight of a node
-  struct ResetNode : public std::unary_function<void, void> {
+  struct ResetNode {
     void operator() (Node<T> *n) {
+      if (n == nullptr) { return; } // missing ID
       n->setState(NOT_VISITED);
       n->setWeight(Node<T>::INFINITY);
     }
   };
 
+  inline bool hasEdge(int from, int to) const {
+    return (_present[from * _words + to / 64] >> (to % 64)) & 1;
+  }
+
+  // Sets or clears a single directed edge in both bitsets
+  void link(int from, int to, T weight);
+  void unlink(int from, int to);
+
   AdjacencyMatrix() = delete; // Removes default constructor
 
 public:
-  // Constructs graph from file input
-  AdjacencyMatrix(std::istream &input, bool directed);
+  /*
+   * Iterates over the edges of a single node by walking one row of a
+   * presence bitset a word at a time, so absent edges cost nothing beyond
+   * their bit. Yields EdgeRef views into the graph's storage.
+   */
+  class EdgeIterator {
+
+  private:
+    Node<T> *_node; // node whose edges are listed
+    Node<T> * const *_nodes;
+    const uint64_t *_row; // first word of the bitset row
+    const uint64_t *_word; // current word
+    const uint64_t *_last; // one past the last word of the row
+    uint64_t _bits; // set bits of the current word not yet visited
+    const T *_weight; // weight of the edge to or from neighbor k is _weight[k * _stride]
+    size_t _stride;
+    bool _reversed; // if set, edges run from the neighbor into _node
+
+    mutable EdgeRef<T> _edge; // view handed out by dereferencing
+
+    // Moves to the next word with a set bit, or to the end of the row
+    inline void skip() {
+      while (_bits == 0 && _word != _last) {
+	if (++_word != _last) { _bits = *_word; }
+      }
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef EdgeRef<T> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const EdgeRef<T> * pointer;
+    typedef const EdgeRef<T> & reference;
+
+    EdgeIterator(Node<T> *node, Node<T> * const *nodes, const uint64_t *row, const uint64_t *word,
+		 const uint64_t *last, const T *weight, size_t stride, bool reversed)
+      : _node(node), _nodes(nodes), _row(row), _word(word), _last(last),
+	_bits(word != last ? *word : 0), _weight(weight), _stride(stride), _reversed(reversed), _edge() {
+      skip();
+    }
+    EdgeIterator(const EdgeIterator &other) = default;
+    EdgeIterator & operator=(const EdgeIterator &other) = default;
+
+    inline reference operator*() const {
+      size_t k = (_word - _row) * 64 + __builtin_ctzll(_bits);
+      _edge = _reversed ? EdgeRef<T>(_nodes[k], _node, _weight[k * _stride])
+	: EdgeRef<T>(_node, _nodes[k], _weight[k * _stride]);
+      return _edge;
+    }
+    inline pointer operator->() const { return &(operator*()); }
+
+    inline EdgeIterator & operator++() { _bits &= _bits - 1; skip(); return *this; }
+    inline EdgeIterator operator++(int) { EdgeIterator tmp(*this); ++(*this); return tmp; }
+
+    inline bool operator==(const EdgeIterator &other) const {
+      return _word == other._word && _bits == other._bits;
+    }
+    inline bool operator!=(const EdgeIterator &other) const { return !(*this == other); }
+  };
+
+  /*
+   * Edges of a node, returned by adjacent() and incoming()
+   */
+  class EdgeRange {
+
+  private:
+    EdgeIterator _begin;
+    EdgeIterator _end;
+
+  public:
+    EdgeRange(const EdgeIterator &b, const EdgeIterator &e) : _begin(b), _end(e) {}
+
+    inline EdgeIterator begin() const { return _begin; }
+    inline EdgeIterator end() const { return _end; }
+  };
+
+  // Constructs graph from file input. With trackIncoming set, the graph also
+  // keeps a transposed bitset and counts the incoming edges of every node,
+  // which makes inDegree() O(1) and enables incoming()
+  AdjacencyMatrix(std::istream &input, bool directed, bool trackIncoming = false)
+    : AdjacencyMatrix(EdgeReader<T>(input), directed, trackIncoming) {}
+
+  // Constructs graph from edges already read, e.g. EdgeReader<T>(filename)
+  AdjacencyMatrix(const EdgeReader<T> &edges, bool directed, bool trackIncoming = false);
+
+  // Graphs own their nodes, so they can be moved but not copied
+  AdjacencyMatrix(AdjacencyMatrix &&other) = default;
   ~AdjacencyMatrix();
 
 
-  inline size_t size() { return _nodes.size(); }
+  inline size_t size() const { return _nodes.size(); }
 
   inline Node<T> *node(int id) const { return _nodes[id]; }
   
   inline bool isDirected() const { return _isDirected; }
 
+  // Returns whether incoming edges are indexed
+  inline bool tracksIncoming() const { return _trackIncoming; }
+
+  // Builds the incoming-edge index of an existing graph and keeps it up to date from now on
+  void trackIncoming();
+
   // Connects two existing nodes
   void addEdge(int from, int to, T weight);
   void addNode(int id);
 
   void removeEdge(int from, int to);
+
+  // Removes the node and every edge into or out of it
+  void removeNode(int id);
   
   // Computes number of incoming and outgoing edges
   size_t inDegree(const Node<T> *n) const;
   size_t outDegree(const Node<T> *n) const;
 
-  // Returns a list of the non-null edges adjacent to specified node
-  const std::list<EdgePtr<T> > adjacent(const Node<T> *n) const;
+  // Returns range over the edges out of specified node, i.e. its row
+  EdgeRange adjacent(const Node<T> *n) const;
+
+  // Returns range over the edges into specified node, i.e. its column; requires the incoming-edge index
+  EdgeRange incoming(const Node<T> *n) const;
   
+  // Writes a snapshot of the graph, to be loaded with CSRGraph<T>::load()
+  void save(const std::string &path) const { CSRGraph<T>(*this).save(path); }
+
   // Sets all nodes as not visited with weight INFINITY
   void reset();
 
   friend std::ostream & operator<<(std::ostream &os, const AdjacencyMatrix<T> &g) {
-    for (size_t i = 0; i < g._graph.size(); i++) {
+    for (size_t i = 0; i < g.size(); i++) {
       os << i << ":";
-      for (auto& edge : g._graph[i]) {
-	if (edge != NULL) {
+      if (g.node(i) != nullptr) {
+	for (auto& edge : g.adjacent(g.node(i))) {
 	  os << "("
 	     << edge->getStart()->getID() << ", "
 	     << edge->getEnd()->getID() << ", "
@@ -102,45 +220,80 @@ public:
 };
 
 template<typename T>
-AdjacencyMatrix<T>::AdjacencyMatrix(std::istream &input, bool directed) 
-  : _nodes(), _isDirected(directed) {
+AdjacencyMatrix<T>::AdjacencyMatrix(const EdgeReader<T> &edges, bool directed, bool trackIncoming)
+  : _present(), _presentT(), _weights(), _words(0), _nodes(), _nodeArena(), _inDegrees(),
+    _isDirected(directed), _trackIncoming(trackIncoming) {
 
-  size_t nNodes, nEdges;
-  input >> nNodes >> nEdges;
+  const size_t nNodes = edges.numNodes();
   
   _nodes.resize(nNodes, nullptr);
-  
-  _graph.resize(nNodes);
-  for (auto& cols : _graph) {
-    cols.resize(nNodes, NULL);
+  _nodeArena.reserve(nNodes);
+  _words = (nNodes + 63) / 64;
+  _present.resize(nNodes * _words, 0);
+  if (_trackIncoming) {
+    _presentT.resize(nNodes * _words, 0);
+    _inDegrees.resize(nNodes, 0);
   }
+  _weights.resize(nNodes * nNodes);
 
-  int from, to; // id's to the two nodes
-  T weight;
-  while (input >> from >> to >> weight) {
-    addNode(from);
-    addNode(to);
-    
-    addEdge(from, to, weight);
+  for (size_t i = 0; i < edges.numEdges(); i++) {
+    addNode(edges.from()[i]);
+    addNode(edges.to()[i]);
+
+    addEdge(edges.from()[i], edges.to()[i], edges.weight()[i]);
   }
 }
 
 template<typename T>
 AdjacencyMatrix<T>::~AdjacencyMatrix() {
-  for_each(_nodes.begin(), _nodes.end(), DeleteObject());
-  _nodes.clear();
+  _nodes.clear(); // the arena releases every node at once
+}
 
-  _graph.clear();
+template<typename T>
+void AdjacencyMatrix<T>::trackIncoming() {
+  if (_trackIncoming) { return; }
+
+  const size_t n = _nodes.size();
+  _presentT.assign(n * _words, 0);
+  _inDegrees.assign(n, 0);
+  for (size_t from = 0; from < n; from++) {
+    for (size_t w = 0; w < _words; w++) {
+      for (uint64_t bits = _present[from * _words + w]; bits != 0; bits &= bits - 1) {
+	size_t to = w * 64 + __builtin_ctzll(bits);
+	_presentT[to * _words + from / 64] |= (uint64_t) 1 << (from % 64);
+	_inDegrees[to]++;
+      }
+    }
+  }
+  _trackIncoming = true;
 }
 
 template<typename T>
-inline void AdjacencyMatrix<T>::addEdge(int from, int to, T weight) {
-  Edge<T> *e = new Edge<T>(_nodes[from], _nodes[to], weight);
-  _graph[from][to] = EdgePtr<T>(e);
+inline void AdjacencyMatrix<T>::link(int from, int to, T weight) {
+  if (_trackIncoming) {
+    if (!hasEdge(from, to)) { _inDegrees[to]++; }
+    _presentT[to * _words + from / 64] |= (uint64_t) 1 << (from % 64);
+  }
 
+  _present[from * _words + to / 64] |= (uint64_t) 1 << (to % 64);
+  _weights[from * size() + to] = weight;
+}
+
+template<typename T>
+inline void AdjacencyMatrix<T>::unlink(int from, int to) {
+  if (_trackIncoming) {
+    if (hasEdge(from, to)) { _inDegrees[to]--; }
+    _presentT[to * _words + from / 64] &= ~((uint64_t) 1 << (from % 64));
+  }
+
+  _present[from * _words + to / 64] &= ~((uint64_t) 1 << (to % 64));
+}
+
+template<typename T>
+inline void AdjacencyMatrix<T>::addEdge(int from, int to, T weight) {
+  link(from, to, weight);
   if (!_isDirected) {
-    Edge<T> *e_rev = new Edge<T>(_nodes[to], _nodes[from], weight);
-    _graph[to][from] = EdgePtr<T>(e_rev);
+    link(to, from, weight);
   }
 }
 
@@ -149,28 +302,39 @@ inline void AdjacencyMatrix<T>::addNode(int id) {
   assert (id < (int) _nodes.size());
 
   if (_nodes[id] == nullptr) {
-    Node<T> *new_node = new Node<T>(id);
+    Node<T> *new_node = _nodeArena.create(id);
     _nodes[id] = new_node;
   }
 }
     
 template<typename T>
 inline void AdjacencyMatrix<T>::removeEdge(int from, int to) {
-  _graph[from][to] = NULL;
+  unlink(from, to);
   if (!_isDirected) {
-    _graph[to][from] = NULL;
+    unlink(to, from);
   }
 }
 
+template<typename T>
+inline void AdjacencyMatrix<T>::removeNode(int id) {
+  if (id < 0 || id >= (int) _nodes.size() || _nodes[id] == nullptr) { return; } // if node doesn't exist
+
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    removeEdge(id, i);
+    removeEdge(i, id);
+  }
+
+  _nodeArena.destroy(_nodes[id]); // returns the node's slot to the arena
+  _nodes[id] = nullptr;
+}
+
 template<typename T>
 inline size_t AdjacencyMatrix<T>::inDegree(const Node<T> *n) const {
-  size_t deg = 0;
-  for (size_t i = 0; i < _graph.size(); i++) {
-    for (auto &edge : _graph[i]) {
-      if (edge->getEnd() == n) {
-	deg++;
-      }
-    }
+  if (_trackIncoming) { return _inDegrees[n->getID()]; }
+
+  size_t deg = 0; // bit n of every row, i.e. the column of n
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    if (hasEdge(i, n->getID())) { deg++; }
   }
   return deg;
 }
@@ -178,20 +342,40 @@ inline size_t AdjacencyMatrix<T>::inDegree(const Node<T> *n) const {
 
 template<typename T>
 inline size_t AdjacencyMatrix<T>::outDegree(const Node<T> *n) const{
-  return _graph[n->getID()].size();
+  size_t deg = 0;
+  for (size_t w = n->getID() * _words; w < (n->getID() + 1) * _words; w++) {
+    deg += __builtin_popcountll(_present[w]);
+  }
+  return deg;
 }
 
 template<typename T>
-inline const std::list<EdgePtr<T> > AdjacencyMatrix<T>::adjacent(const Node<T> *n) const {
-  std::list<EdgePtr<T> > edges;
-  if (n->getID() < 0 || (size_t)n->getID() > _graph.size()) {
+inline typename AdjacencyMatrix<T>::EdgeRange AdjacencyMatrix<T>::adjacent(const Node<T> *n) const {
+  if (n->getID() < 0 || (size_t)n->getID() >= _nodes.size()) {
     throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
   }
   
-  copy_if(_graph[n->getID()].begin(), _graph[n->getID()].end(), std::inserter(edges, edges.begin()), 
-	  [](EdgePtr<T> e){return !(e == NULL); } );
-  
-  return edges;
+  const uint64_t *row = _present.data() + n->getID() * _words, *last = row + _words;
+  const T *weights = _weights.data() + n->getID() * size();
+  Node<T> *start = _nodes[n->getID()];
+  return EdgeRange(EdgeIterator(start, _nodes.data(), row, row, last, weights, 1, false),
+		   EdgeIterator(start, _nodes.data(), row, last, last, weights, 1, false));
+}
+
+template<typename T>
+inline typename AdjacencyMatrix<T>::EdgeRange AdjacencyMatrix<T>::incoming(const Node<T> *n) const {
+  if (n->getID() < 0 || (size_t)n->getID() >= _nodes.size()) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
+  }
+  if (!_trackIncoming) {
+    throw std::logic_error("Incoming edges are not tracked");
+  }
+
+  const uint64_t *row = _presentT.data() + n->getID() * _words, *last = row + _words;
+  const T *weights = _weights.data() + n->getID(); // column, one row apart
+  Node<T> *end = _nodes[n->getID()];
+  return EdgeRange(EdgeIterator(end, _nodes.data(), row, row, last, weights, size(), true),
+		   EdgeIterator(end, _nodes.data(), row, last, last, weights, size(), true));
 }
   
 template<typename T>
@@ -0,0 +1,117 @@
+#ifndef _ARENA_HH_
+#define _ARENA_HH_
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+
+/*
+ * Slab allocator for objects of a single type. Objects are carved out of
+ * large slabs instead of being allocated one by one, freed slots are
+ * reused by later objects, and all slabs are released together when the
+ * arena is destroyed. Objects must be trivially destructible, so releasing
+ * the slabs is all the destruction they need.
+ */
+template <typename Object>
+class Arena {
+
+  static_assert(std::is_trivially_destructible<Object>::value,
+		"Arena objects must be trivially destructible");
+
+private:
+  // A slot holds either a live object or a link in the list of free slots
+  union Slot {
+    Slot *next;
+    typename std::aligned_storage<sizeof(Object), alignof(Object)>::type object;
+  };
+
+  std::vector<std::unique_ptr<Slot[]> > _slabs;
+  size_t _slabSize; // slots in the next slab allocated
+  size_t _used; // slots handed out from the last slab
+  size_t _capacity; // slots in the last slab
+  size_t _slots; // slots in all slabs
+
+  Slot *_free; // most recently freed slot
+  size_t _live; // number of live objects
+
+  // Allocates a slab with room for at least count objects
+  void grow(size_t count) {
+    _capacity = std::max(count, _slabSize);
+    _slabs.emplace_back(new Slot[_capacity]);
+    _slots += _capacity;
+    _used = 0;
+    _slabSize = std::min(2 * _slabSize, (size_t) MAX_SLAB);
+  }
+
+public:
+  static const size_t MIN_SLAB = 64;
+  static const size_t MAX_SLAB = 1 << 20;
+
+  Arena() : _slabs(), _slabSize(MIN_SLAB), _used(0), _capacity(0), _slots(0), _free(nullptr), _live(0) {}
+  Arena(const Arena &other) = delete;
+  Arena & operator=(const Arena &other) = delete;
+
+  // Takes over the slabs of other, leaving it empty
+  Arena(Arena &&other)
+    : _slabs(std::move(other._slabs)), _slabSize(other._slabSize), _used(other._used),
+      _capacity(other._capacity), _slots(other._slots), _free(other._free), _live(other._live) {
+    other.clear();
+  }
+
+  ~Arena() {}
+
+  // Returns number of live objects
+  inline size_t size() const { return _live; }
+
+  // Returns number of bytes held in slabs
+  inline size_t bytes() const { return _slots * sizeof(Slot); }
+
+  // Makes room for count more objects without further allocation
+  void reserve(size_t count) {
+    if (_capacity - _used < count) { grow(count); }
+  }
+
+  // Constructs an object in the arena
+  template <typename... Args>
+  Object * create(Args&&... args) {
+    Slot *slot;
+    if (_free != nullptr) {
+      slot = _free;
+      _free = _free->next;
+    }
+    else {
+      if (_used == _capacity) { grow(_slabSize); }
+      slot = &_slabs.back()[_used++];
+    }
+    _live++;
+    return new (&slot->object) Object(std::forward<Args>(args)...);
+  }
+
+  // Returns the slot of an object created by this arena for reuse
+  void destroy(Object *obj) {
+    Slot *slot = reinterpret_cast<Slot *>(obj);
+    slot->next = _free;
+    _free = slot;
+    _live--;
+  }
+
+  // Releases every object at once
+  void clear() {
+    _slabs.clear();
+    _slabSize = MIN_SLAB;
+    _used = _capacity = _slots = 0;
+    _free = nullptr;
+    _live = 0;
+  }
+};
+
+template <typename Object>
+const size_t Arena<Object>::MIN_SLAB;
+
+template <typename Object>
+const size_t Arena<Object>::MAX_SLAB;
+
+#endif // _ARENA_HH_
@@ -0,0 +1,49 @@
+#ifndef _ATOMICBITMAP_HH_
+#define _ATOMICBITMAP_HH_
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Fixed-size set of node IDs, one bit per node, that many threads can
+ * update at once
+ */
+class AtomicBitmap {
+
+private:
+  std::vector<std::atomic<uint64_t> > _words; // value-initialized to zero
+
+  size_t _size;
+
+  static inline uint64_t mask(size_t i) { return (uint64_t) 1 << (i & 63); }
+
+  AtomicBitmap() = delete;
+
+public:
+  explicit AtomicBitmap(size_t n) : _words((n + 63) / 64), _size(n) {}
+
+  inline size_t size() const { return _size; }
+
+  inline bool get(size_t i) const {
+    return (_words[i >> 6].load(std::memory_order_relaxed) & mask(i)) != 0;
+  }
+
+  // Sets bit i, returning true if this call is the one that set it
+  inline bool set(size_t i) {
+    return (_words[i >> 6].fetch_or(mask(i), std::memory_order_relaxed) & mask(i)) == 0;
+  }
+
+  // Clears the words in [first, last), which lets callers split the work
+  inline void clearWords(size_t first, size_t last) {
+    for (size_t w = first; w < last; w++) {
+      _words[w].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline size_t numWords() const { return _words.size(); }
+
+  inline void clear() { clearWords(0, _words.size()); }
+};
+
+#endif // _ATOMICBITMAP_HH_
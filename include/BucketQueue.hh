@@ -0,0 +1,164 @@
+#ifndef _BUCKETQUEUE_HH_
+#define _BUCKETQUEUE_HH_
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+
+/*
+ * Addressable bucket (Dial) queue of node IDs for integer distances. With
+ * edge weights in [0, maxWeight], the keys in the queue of a shortest path
+ * search always lie in [min, min + maxWeight], so maxWeight + 1 circular
+ * buckets hold exactly one key each. Push and decrease are O(1), and pop
+ * scans at most maxWeight + 1 buckets. Keys must be non-negative and popped
+ * in non-decreasing order, which is the case for Dijkstra. A key below the
+ * last one popped, or more than maxWeight above it (e.g. from an edge
+ * heavier than maxWeight), would share a bucket with other keys, so push and
+ * decrease reject it.
+ */
+template <typename T>
+class BucketQueue {
+
+private:
+  std::vector<int> _buckets; // first ID of every bucket, -1 if empty
+  std::vector<int> _next; // doubly-linked list of IDs within a bucket
+  std::vector<int> _prev;
+  std::vector<int> _bucket; // bucket of every ID, -1 if not in the queue
+  std::vector<T> _keys;
+
+  size_t _count;
+  mutable T _cursor; // lower bound on the smallest key in the queue
+
+  static_assert(std::is_integral<T>::value, "Bucket queue requires integer weights");
+
+  void link(int id, T key);
+  void unlink(int id);
+
+  // Throws if a key does not fit in the buckets after the last key popped
+  void check(T key) const;
+
+  // Moves the cursor to the first non-empty bucket
+  void advance() const;
+
+  BucketQueue() = delete;
+
+public:
+  BucketQueue(size_t n, T maxWeight)
+    : _buckets(maxWeight + 1, -1), _next(n, -1), _prev(n, -1), _bucket(n, -1), _keys(n, 0),
+      _count(0), _cursor(0) {}
+
+  // Allows IDs up to n - 1
+  inline void resize(size_t n) {
+    if (n > _bucket.size()) {
+      _next.resize(n, -1);
+      _prev.resize(n, -1);
+      _bucket.resize(n, -1);
+      _keys.resize(n, 0);
+    }
+  }
+
+  inline bool empty() const { return _count == 0; }
+  inline size_t size() const { return _count; }
+
+  inline bool contains(int id) const { return _bucket[id] != -1; }
+
+  // Returns the ID and key with the smallest key; the queue must not be empty
+  int top() const;
+  inline T topKey() const { return _keys[top()]; }
+
+  // Adds an ID that is not in the queue
+  void push(int id, T key);
+
+  // Lowers the key of an ID already in the queue
+  void decrease(int id, T key);
+
+  // Removes and returns the ID with the smallest key
+  int pop();
+
+  // Empties the queue in time proportional to the number of buckets
+  void clear();
+};
+
+template<typename T>
+inline void BucketQueue<T>::link(int id, T key) {
+  int b = key % _buckets.size();
+  _keys[id] = key;
+  _bucket[id] = b;
+  _prev[id] = -1;
+  _next[id] = _buckets[b];
+  if (_buckets[b] != -1) { _prev[_buckets[b]] = id; }
+  _buckets[b] = id;
+}
+
+template<typename T>
+inline void BucketQueue<T>::unlink(int id) {
+  int b = _bucket[id];
+  if (_prev[id] != -1) { _next[_prev[id]] = _next[id]; }
+  else { _buckets[b] = _next[id]; }
+  if (_next[id] != -1) { _prev[_next[id]] = _prev[id]; }
+  _bucket[id] = -1;
+}
+
+template<typename T>
+inline void BucketQueue<T>::check(T key) const {
+  if (key < 0 || (_count > 0 && (key < _cursor || (size_t) (key - _cursor) >= _buckets.size()))) {
+    throw std::out_of_range("Key out of range of the buckets - " + std::to_string(key));
+  }
+}
+
+template<typename T>
+inline void BucketQueue<T>::advance() const {
+  while (_buckets[_cursor % _buckets.size()] == -1) {
+    _cursor++;
+  }
+}
+
+template<typename T>
+inline int BucketQueue<T>::top() const {
+  if (_count == 0) { throw std::out_of_range("Queue is empty"); }
+  advance();
+  return _buckets[_cursor % _buckets.size()];
+}
+
+template<typename T>
+inline void BucketQueue<T>::push(int id, T key) {
+  check(key);
+  if (_count == 0) { _cursor = key; }
+
+  link(id, key);
+  _count++;
+}
+
+template<typename T>
+inline void BucketQueue<T>::decrease(int id, T key) {
+  if (_keys[id] < key) {
+    throw std::invalid_argument("Key can only be decreased - " + std::to_string(id));
+  }
+  check(key);
+
+  unlink(id);
+  link(id, key);
+}
+
+template<typename T>
+inline int BucketQueue<T>::pop() {
+  int id = top();
+  unlink(id);
+  _count--;
+  return id;
+}
+
+template<typename T>
+inline void BucketQueue<T>::clear() {
+  for (auto& head : _buckets) {
+    for (int id = head; id != -1; id = _next[id]) {
+      _bucket[id] = -1;
+    }
+    head = -1;
+  }
+  _count = 0;
+  _cursor = 0;
+}
+
+#endif // _BUCKETQUEUE_HH_
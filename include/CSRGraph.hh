@@ -0,0 +1,416 @@
+#ifndef _CSRGRAPH_HH_
+#define _CSRGRAPH_HH_
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstddef>
+#include <limits>
+
+#include "Node.hh"
+#include "Edge.hh"
+#include "EdgeReader.hh"
+#include "Snapshot.hh"
+
+template <typename T>
+class CSRGraph;
+
+/*
+ * Forward declaration of friend methods of the class
+ */
+template<typename T>
+bool hasNegativeCycle(const CSRGraph<T> &g);
+
+/*
+ * Describes an immutable compressed-sparse-row representation of the graph
+ * data structure. The outgoing edges of node i are stored contiguously in
+ * [_offsets[i], _offsets[i+1]) of the target and weight arrays, so a neighbor
+ * scan is a linear walk with no per-edge allocation. The arrays are either
+ * owned by the graph or point straight into a memory-mapped snapshot.
+ */
+template <typename T>
+class CSRGraph {
+
+private:
+  // Arrays owned by the graph, empty when it is served from a snapshot
+  std::vector<size_t> _offsetStore;
+  std::vector<int> _targetStore;
+  std::vector<T> _weightStore;
+
+  std::shared_ptr<const MappedFile> _snapshot; // mapping the arrays point into, if any
+
+  const size_t *_offsets; // size() + 1 entries, indexed by node ID
+  const int *_targets; // end node ID of every edge
+  const T *_weights; // weight of every edge
+  size_t _nEdges;
+
+  // Nodes only carry traversal state, which is not part of the structure
+  mutable std::vector<Node<T> > _nodes;
+
+  bool _isDirected;
+
+  // Fills the arrays from a list of edges, adding the reverse of each edge if mirror is set
+  void build(size_t nNodes, const std::vector<int> &from, const std::vector<int> &to,
+	     const std::vector<T> &weight, bool mirror);
+
+  // Points the arrays at the owned stores
+  inline void own() {
+    _offsets = _offsetStore.data();
+    _targets = _targetStore.data();
+    _weights = _weightStore.data();
+    _nEdges = _targetStore.size();
+  }
+
+  // Empty graph, filled in by build() or load()
+  CSRGraph(bool directed)
+    : _offsetStore(1, 0), _targetStore(), _weightStore(), _snapshot(),
+      _offsets(nullptr), _targets(nullptr), _weights(nullptr), _nEdges(0),
+      _nodes(), _isDirected(directed) { own(); }
+
+  CSRGraph() = delete; // Removes default constructor
+
+public:
+  /*
+   * Iterates over the outgoing edges of a single node, yielding EdgeRef views
+   */
+  class EdgeIterator {
+
+  private:
+    Node<T> *_start;
+    Node<T> *_nodes;
+    const int *_target;
+    const T *_weight;
+
+    mutable EdgeRef<T> _edge; // view handed out by dereferencing
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef EdgeRef<T> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const EdgeRef<T> * pointer;
+    typedef const EdgeRef<T> & reference;
+
+    EdgeIterator(Node<T> *start, Node<T> *nodes, const int *target, const T *weight)
+      : _start(start), _nodes(nodes), _target(target), _weight(weight), _edge() {}
+    EdgeIterator(const EdgeIterator &other) = default;
+    EdgeIterator & operator=(const EdgeIterator &other) = default;
+
+    inline reference operator*() const {
+      _edge = EdgeRef<T>(_start, _nodes + *_target, *_weight);
+      return _edge;
+    }
+    inline pointer operator->() const { return &(operator*()); }
+
+    inline EdgeIterator & operator++() { ++_target; ++_weight; return *this; }
+    inline EdgeIterator operator++(int) { EdgeIterator tmp(*this); ++(*this); return tmp; }
+
+    inline bool operator==(const EdgeIterator &other) const { return _target == other._target; }
+    inline bool operator!=(const EdgeIterator &other) const { return _target != other._target; }
+  };
+
+  /*
+   * Contiguous range of outgoing edges, returned by adjacent()
+   */
+  class EdgeRange {
+
+  private:
+    EdgeIterator _begin;
+    EdgeIterator _end;
+
+  public:
+    EdgeRange(const EdgeIterator &b, const EdgeIterator &e) : _begin(b), _end(e) {}
+
+    inline EdgeIterator begin() const { return _begin; }
+    inline EdgeIterator end() const { return _end; }
+  };
+
+  // Constructs graph from file input of the following format:
+  // numNodes numEdges
+  // startID endID edgeWeight // Edge 1
+  // ...
+  CSRGraph(std::istream &input, bool directed) : CSRGraph(EdgeReader<T>(input), directed) {}
+
+  // Constructs graph from edges already read, e.g. EdgeReader<T>(filename)
+  CSRGraph(const EdgeReader<T> &edges, bool directed);
+
+  // Constructs a compressed copy of an AdjacencyList or AdjacencyMatrix
+  template<class Graph_T>
+  explicit CSRGraph(const Graph_T &g);
+
+  CSRGraph(const CSRGraph &other);
+  CSRGraph & operator=(const CSRGraph &other);
+
+  // Moving keeps the arrays where they are, so the pointers stay valid
+  CSRGraph(CSRGraph &&other) = default;
+  CSRGraph & operator=(CSRGraph &&other) = default;
+
+  ~CSRGraph() {}
+
+  // Maps a snapshot written by save() and serves adjacency from the mapping
+  // without copying it. verify checks the checksum, which reads the whole file;
+  // the offsets and targets are checked either way.
+  static CSRGraph<T> load(const std::string &path, bool verify = true);
+
+  // Writes a snapshot of the graph, optionally with the current node weights
+  void save(const std::string &path, bool nodeWeights = false) const;
+
+  // Returns number of nodes
+  inline size_t size() const { return _nodes.size(); }
+
+  // Returns number of stored edges (both directions of an undirected edge)
+  inline size_t numEdges() const { return _nEdges; }
+
+  // Returns node with the specified ID
+  inline Node<T> * node(int id) const { return &_nodes[id]; }
+
+  // Returns whether the graph is directed
+  inline bool isDirected() const { return _isDirected; }
+
+  // Computes number of incoming and outgoing edges
+  size_t inDegree(const Node<T> *n) const;
+  size_t outDegree(const Node<T> *n) const;
+
+  // Returns range over all outgoing edges from a node
+  EdgeRange adjacent(const Node<T> *n) const;
+
+  // Returns the graph with every edge reversed, whose adjacent() lists incoming edges
+  CSRGraph<T> transpose() const;
+
+  // Returns a copy where every edge (from, to, weight) has weight f(from, to, weight)
+  template<class Function>
+  CSRGraph<T> reweighted(Function f) const;
+
+  // Sets all nodes as not visited with weight INFINITY
+  void reset();
+
+  // Prints the graph in the same format as AdjacencyList
+  friend std::ostream & operator<<(std::ostream &os, const CSRGraph<T> &g) {
+    for (size_t i = 0; i < g.size(); i++) {
+      os << i << ":";
+      for (size_t e = g._offsets[i]; e < g._offsets[i + 1]; e++) {
+	os << "("
+	   << i << ", "
+	   << g._targets[e] << ", "
+	   << g._weights[e] << ")";
+      }
+      os << std::endl;
+    }
+    return os;
+  }
+
+};
+
+template<typename T>
+CSRGraph<T>::CSRGraph(const EdgeReader<T> &edges, bool directed)
+  : CSRGraph(directed) {
+
+  build(edges.numNodes(), edges.from(), edges.to(), edges.weight(), !directed);
+}
+
+template<typename T>
+template<class Graph_T>
+CSRGraph<T>::CSRGraph(const Graph_T &g)
+  : CSRGraph(g.isDirected()) {
+
+  std::vector<int> from, to;
+  std::vector<T> weights;
+
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) == nullptr) { continue; } // missing ID becomes an isolated node
+    for (auto& edge : g.adjacent(g.node(i))) {
+      from.push_back(edge->getStart()->getID());
+      to.push_back(edge->getEnd()->getID());
+      weights.push_back(edge->getWeight());
+    }
+  }
+
+  // Source graph already stores both directions of undirected edges
+  build(g.size(), from, to, weights, false);
+}
+
+template<typename T>
+void CSRGraph<T>::build(size_t nNodes, const std::vector<int> &from, const std::vector<int> &to,
+			const std::vector<T> &weight, bool mirror) {
+  size_t nEdges = mirror ? 2 * from.size() : from.size();
+
+  _nodes.clear();
+  _nodes.reserve(nNodes);
+  for (size_t i = 0; i < nNodes; i++) {
+    _nodes.push_back(Node<T>(i));
+  }
+
+  // First pass: count outgoing edges of every node
+  _offsetStore.assign(nNodes + 1, 0);
+  for (size_t i = 0; i < from.size(); i++) {
+    _offsetStore[from[i] + 1]++;
+    if (mirror) { _offsetStore[to[i] + 1]++; }
+  }
+  for (size_t i = 0; i < nNodes; i++) {
+    _offsetStore[i + 1] += _offsetStore[i];
+  }
+
+  // Second pass: place edges, keeping input order within each node
+  _targetStore.resize(nEdges);
+  _weightStore.resize(nEdges);
+  std::vector<size_t> next(_offsetStore.begin(), _offsetStore.end() - 1);
+  for (size_t i = 0; i < from.size(); i++) {
+    size_t pos = next[from[i]]++;
+    _targetStore[pos] = to[i];
+    _weightStore[pos] = weight[i];
+
+    if (mirror) {
+      pos = next[to[i]]++;
+      _targetStore[pos] = from[i];
+      _weightStore[pos] = weight[i];
+    }
+  }
+
+  _snapshot.reset();
+  own();
+}
+
+template<typename T>
+CSRGraph<T>::CSRGraph(const CSRGraph &other)
+  : _offsetStore(other._offsetStore), _targetStore(other._targetStore), _weightStore(other._weightStore),
+    _snapshot(other._snapshot), _offsets(other._offsets), _targets(other._targets),
+    _weights(other._weights), _nEdges(other._nEdges), _nodes(other._nodes), _isDirected(other._isDirected) {
+  if (!_snapshot) { own(); } // copies of a snapshot share the mapping
+}
+
+template<typename T>
+CSRGraph<T> & CSRGraph<T>::operator=(const CSRGraph &other) {
+  if (this != &other) {
+    _offsetStore = other._offsetStore;
+    _targetStore = other._targetStore;
+    _weightStore = other._weightStore;
+    _snapshot = other._snapshot;
+    _offsets = other._offsets;
+    _targets = other._targets;
+    _weights = other._weights;
+    _nEdges = other._nEdges;
+    _nodes = other._nodes;
+    _isDirected = other._isDirected;
+    if (!_snapshot) { own(); }
+  }
+  return *this;
+}
+
+template<typename T>
+CSRGraph<T> CSRGraph<T>::load(const std::string &path, bool verify) {
+  std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+  const SnapshotHeader &header = Snapshot::validate<T>(*file, verify);
+  const Snapshot::Layout layout(header);
+
+  CSRGraph<T> g((header.flags & Snapshot::DIRECTED) != 0);
+  g._snapshot = file;
+  g._offsets = reinterpret_cast<const size_t *>(file->data() + layout.offsets);
+  g._targets = reinterpret_cast<const int *>(file->data() + layout.targets);
+  g._weights = reinterpret_cast<const T *>(file->data() + layout.weights);
+  g._nEdges = header.nEdges;
+
+  // Checked whether or not verify is set, since every query trusts them
+  if (header.nNodes > (uint64_t) std::numeric_limits<int>::max()) {
+    throw std::runtime_error("Snapshot has too many nodes");
+  }
+  if (g._offsets[0] != 0 || g._offsets[header.nNodes] != header.nEdges) {
+    throw std::runtime_error("Snapshot is corrupt");
+  }
+  for (size_t i = 0; i < header.nNodes; i++) {
+    if (g._offsets[i] > g._offsets[i + 1]) {
+      throw std::runtime_error("Snapshot offsets decrease at node " + std::to_string(i));
+    }
+  }
+  for (size_t i = 0; i < header.nEdges; i++) {
+    if (g._targets[i] < 0 || (uint64_t) g._targets[i] >= header.nNodes) {
+      throw std::runtime_error("Snapshot edge " + std::to_string(i) + " has an invalid target");
+    }
+  }
+
+  g._nodes.reserve(header.nNodes);
+  for (size_t i = 0; i < header.nNodes; i++) {
+    g._nodes.push_back(Node<T>(i));
+  }
+  if (header.flags & Snapshot::NODE_WEIGHTS) {
+    const T *weights = reinterpret_cast<const T *>(file->data() + layout.nodeWeights);
+    for (size_t i = 0; i < header.nNodes; i++) { g._nodes[i].setWeight(weights[i]); }
+  }
+  return g;
+}
+
+template<typename T>
+void CSRGraph<T>::save(const std::string &path, bool nodeWeights) const {
+  std::vector<T> weights;
+  if (nodeWeights) {
+    for (auto& n : _nodes) { weights.push_back(n.getWeight()); }
+  }
+
+  Snapshot::write(path, _isDirected, size(), _nEdges, _offsets, _targets, _weights,
+		  nodeWeights ? weights.data() : (const T *) nullptr);
+}
+
+template<typename T>
+inline size_t CSRGraph<T>::inDegree(const Node<T> *n) const {
+  return std::count(_targets, _targets + _nEdges, n->getID());
+}
+
+template<typename T>
+inline size_t CSRGraph<T>::outDegree(const Node<T> *n) const {
+  return _offsets[n->getID() + 1] - _offsets[n->getID()];
+}
+
+template<typename T>
+inline typename CSRGraph<T>::EdgeRange CSRGraph<T>::adjacent(const Node<T> *n) const {
+  if (n->getID() < 0 || (size_t)n->getID() >= _nodes.size()) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
+  }
+
+  size_t first = _offsets[n->getID()], last = _offsets[n->getID() + 1];
+  Node<T> *start = &_nodes[n->getID()];
+  return EdgeRange(EdgeIterator(start, _nodes.data(), _targets + first, _weights + first),
+		   EdgeIterator(start, _nodes.data(), _targets + last, _weights + last));
+}
+
+template<typename T>
+CSRGraph<T> CSRGraph<T>::transpose() const {
+  std::vector<int> from(_nEdges);
+  for (size_t i = 0; i < size(); i++) {
+    std::fill(from.begin() + _offsets[i], from.begin() + _offsets[i + 1], (int) i);
+  }
+
+  CSRGraph<T> reversed(_isDirected);
+  reversed.build(size(), std::vector<int>(_targets, _targets + _nEdges), from,
+		 std::vector<T>(_weights, _weights + _nEdges), false);
+  return reversed;
+}
+
+template<typename T>
+template<class Function>
+CSRGraph<T> CSRGraph<T>::reweighted(Function f) const {
+  CSRGraph<T> copy(_isDirected);
+  copy._offsetStore.assign(_offsets, _offsets + size() + 1);
+  copy._targetStore.assign(_targets, _targets + _nEdges);
+  copy._weightStore.resize(_nEdges);
+  for (size_t i = 0; i < size(); i++) {
+    for (size_t e = _offsets[i]; e < _offsets[i + 1]; e++) {
+      copy._weightStore[e] = f((int) i, _targets[e], _weights[e]);
+    }
+  }
+  copy._nodes = _nodes;
+  copy.own();
+  return copy;
+}
+
+template<typename T>
+inline void CSRGraph<T>::reset() {
+  for (auto& n : _nodes) {
+    n.setState(NOT_VISITED);
+    n.setWeight(Node<T>::INFINITY);
+  }
+}
+
+#endif // _CSRGRAPH_HH_
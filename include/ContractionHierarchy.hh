@@ -0,0 +1,698 @@
+#ifndef _CONTRACTIONHIERARCHY_HH_
+#define _CONTRACTIONHIERARCHY_HH_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+#include "Node.hh"
+#include "QueryContext.hh"
+#include "IndexedHeap.hh"
+#include "ThreadPool.hh"
+#include "MappedFile.hh"
+#include "Snapshot.hh"
+
+/*
+ * Fixed 64-byte header of a contraction hierarchy file. The header is
+ * followed by these arrays, each starting on an 8-byte boundary and
+ * zero-padded to one:
+ *   rank          int32[nNodes]
+ *   up offsets    uint64[nNodes + 1]
+ *   up targets    int32[nUp]
+ *   up middles    int32[nUp]
+ *   up weights    weight[nUp]
+ *   down offsets, targets, middles, weights, likewise with nDown arcs
+ * All values are little-endian, and the checksum covers every byte after
+ * the header.
+ */
+struct HierarchyHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t weightSize; // bytes per weight
+  uint32_t weightKind; // one of Snapshot::UNSIGNED, SIGNED, REAL
+  uint32_t reserved32; // zero
+  uint64_t nNodes;
+  uint64_t nUp;
+  uint64_t nDown;
+  uint64_t checksum;
+  uint64_t reserved; // zero
+};
+
+static_assert(sizeof(HierarchyHeader) == 64, "Hierarchy header must be 64 bytes");
+
+/*
+ * Contraction hierarchy for fast point-to-point shortest path queries on a
+ * static graph with non-negative edge weights.
+ *
+ * Preprocessing contracts the nodes one level at a time. Contracting a node
+ * removes it from the remaining graph and adds a shortcut u -> w for every
+ * path u -> v -> w through it that no other path (a witness) matches. The
+ * next nodes to contract are those whose priority, twice the edge
+ * difference (shortcuts added minus edges removed) plus the number of
+ * neighbors already contracted, is lower than that of all their neighbors. They are
+ * pairwise non-adjacent, so their witness searches run in parallel.
+ *
+ * Every edge and shortcut leads from a lower to a higher level in one
+ * direction, so a query is a bidirectional Dijkstra search that only goes
+ * upward from both ends. Shortcuts remember the node they skip, which is
+ * how found paths are unpacked into original edges.
+ */
+template <typename T>
+class ContractionHierarchy {
+
+public:
+  // Edge or shortcut of the hierarchy; middle is the node a shortcut skips, -1 for edges
+  struct Arc {
+    int target;
+    int middle;
+    T weight;
+  };
+
+  /*
+   * Search state of one query, reusable across queries. Any number of
+   * queries can run against the same hierarchy at once, one Query per thread.
+   */
+  class Query {
+
+    friend class ContractionHierarchy<T>;
+
+  private:
+    QueryContext<T> _forward;
+    QueryContext<T> _backward;
+    IndexedHeap<T> _forwardQueue;
+    IndexedHeap<T> _backwardQueue;
+
+  public:
+    Query(size_t n = 0)
+      : _forward(n), _backward(n), _forwardQueue(n), _backwardQueue(n) {}
+  };
+
+private:
+  static const uint32_t VERSION = 1;
+  // Nodes a witness search may settle when contracting, and when only
+  // estimating a priority; missing a witness only costs an extra shortcut
+  static const size_t SETTLE_LIMIT = 500;
+  static const size_t ESTIMATE_LIMIT = 20;
+
+  std::vector<int> _rank; // level of every node, 0 is contracted first
+  std::vector<size_t> _upOffsets;
+  std::vector<Arc> _up; // arcs to higher nodes, by start node
+  std::vector<size_t> _downOffsets;
+  std::vector<Arc> _down; // arcs from higher nodes, by end node; target is the start node
+
+  // Node states while contracting
+  enum { ALIVE, CONTRACTING, CONTRACTED };
+
+  // Graph of the nodes not contracted yet
+  struct Overlay {
+    std::vector<std::vector<Arc> > out;
+    std::vector<std::vector<Arc> > in; // target is the start node
+    std::vector<char> state;
+
+    Overlay(size_t n) : out(n), in(n), state(n, ALIVE) {}
+  };
+
+  // Shortcut through the node being contracted
+  struct Shortcut {
+    int from;
+    int to;
+    T weight;
+  };
+
+  // Search state of one preprocessing thread
+  struct Worker {
+    QueryContext<T> ctx;
+    IndexedHeap<T> heap;
+    std::vector<Shortcut> shortcuts;
+
+    Worker(size_t n) : ctx(n), heap(n), shortcuts() {}
+  };
+
+  // Runs a Dijkstra search from src around skip and nodes being contracted,
+  // until the targets of skip are settled, the search passes limit, or it
+  // settled maxSettled nodes
+  static void witnessSearch(const Overlay &g, int src, int skip, T limit, size_t maxSettled, Worker &w);
+
+  // Finds the shortcuts that contracting v needs into w.shortcuts
+  static void findShortcuts(const Overlay &g, int v, size_t maxSettled, Worker &w);
+
+  // Adds an arc to the overlay, or lowers the weight of an existing one
+  static void addArc(Overlay &g, int from, int to, T weight, int middle);
+
+  // Removes the arc to target from a list
+  static inline void dropArc(std::vector<Arc> &arcs, int target) {
+    for (size_t i = 0; i < arcs.size(); i++) {
+      if (arcs[i].target == target) {
+	arcs[i] = arcs.back();
+	arcs.pop_back();
+	return;
+      }
+    }
+  }
+
+  // Packs per-node arc lists into offsets and arcs
+  static void pack(std::vector<std::vector<Arc> > &lists, std::vector<size_t> &offsets,
+		   std::vector<Arc> &arcs);
+
+  // Returns the arc of the hierarchy between two adjacent nodes
+  const Arc & arc(int from, int to) const;
+
+  // Runs a query, returning the distance and the node where both searches meet
+  T search(int src, int dest, Query &q, int &meet) const;
+
+  ContractionHierarchy() : _rank(), _upOffsets(), _up(), _downOffsets(), _down() {}
+
+public:
+  /*
+   * Preprocesses an AdjacencyList, AdjacencyMatrix or CSRGraph. Edge weights
+   * must not be negative, and parallel edges keep their lightest weight.
+   */
+  template<class Graph_T>
+  explicit ContractionHierarchy(const Graph_T &g, unsigned threads = ThreadPool::hardwareThreads());
+
+  // Reads a hierarchy written by save(). verify checks the checksum; the
+  // sizes, ranks, offsets and arc nodes are checked either way.
+  static ContractionHierarchy<T> load(const std::string &path, bool verify = true);
+
+  // Writes the hierarchy, so that preprocessing runs once
+  void save(const std::string &path) const;
+
+  // Returns number of nodes
+  inline size_t size() const { return _rank.size(); }
+
+  // Returns number of edges and shortcuts
+  inline size_t numArcs() const { return _up.size() + _down.size(); }
+
+  // Returns the level of a node
+  inline int rank(int id) const { return _rank[id]; }
+
+  // Returns the shortest distance between two nodes, INFINITY if dest is not reachable
+  inline T distance(int src, int dest, Query &q) const {
+    int meet;
+    return search(src, dest, q, meet);
+  }
+
+  inline T distance(int src, int dest) const {
+    Query q(size());
+    return distance(src, dest, q);
+  }
+
+  // Returns the node IDs on a shortest path from src to dest, or an empty
+  // path if dest is not reachable
+  std::vector<int> path(int src, int dest, Query &q) const;
+
+  inline std::vector<int> path(int src, int dest) const {
+    Query q(size());
+    return path(src, dest, q);
+  }
+};
+
+template<typename T>
+const uint32_t ContractionHierarchy<T>::VERSION;
+
+template<typename T>
+const size_t ContractionHierarchy<T>::SETTLE_LIMIT;
+
+template<typename T>
+const size_t ContractionHierarchy<T>::ESTIMATE_LIMIT;
+
+template<typename T>
+template<class Graph_T>
+ContractionHierarchy<T>::ContractionHierarchy(const Graph_T &g, unsigned threads)
+  : _rank(g.size(), -1), _upOffsets(), _up(), _downOffsets(), _down() {
+
+  const size_t n = g.size();
+  Overlay overlay(n);
+
+  // Copies the graph, keeping the lightest of parallel edges and dropping loops
+  for (size_t i = 0; i < n; i++) {
+    if (g.node(i) == nullptr) { continue; }
+    for (auto& edge : g.adjacent(g.node(i))) {
+      if (edge->getWeight() < 0) {
+	throw std::runtime_error("Error: Negative Edge Weight - " +
+				 std::to_string(edge->getWeight()));
+      }
+      int to = edge->getEnd()->getID();
+      if (to != (int) i) { addArc(overlay, i, to, edge->getWeight(), -1); }
+    }
+  }
+
+  ThreadPool pool(threads);
+  std::vector<Worker> workers(pool.size(), Worker(n));
+
+  std::vector<int> deleted(n, 0); // contracted neighbors of every node
+  std::vector<long long> priority(n);
+  auto prioritize = [&](int v, Worker &w) {
+    findShortcuts(overlay, v, ESTIMATE_LIMIT, w);
+    long long difference = (long long) w.shortcuts.size() - (long long) overlay.out[v].size()
+      - (long long) overlay.in[v].size();
+    priority[v] = 2 * difference + deleted[v];
+  };
+
+  std::vector<int> remaining(n);
+  for (size_t i = 0; i < n; i++) { remaining[i] = i; }
+  pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned id) {
+      for (size_t i = b; i < e; i++) { prioritize(i, workers[id]); }
+    }, 64);
+
+  // Ties are broken by ID, so neighbors never both look lower than each other
+  auto lower = [&](int a, int b) {
+    return (priority[a] != priority[b]) ? priority[a] < priority[b] : a < b;
+  };
+
+  std::vector<char> selected(n, false);
+  std::vector<int> level, touched;
+  std::vector<std::vector<Shortcut> > pending;
+  std::vector<std::vector<Arc> > up(n), down(n);
+  std::vector<size_t> stamp(n, 0);
+  int nextRank = 0;
+
+  for (size_t round = 1; !remaining.empty(); round++) {
+    // Selects the nodes that are lower than all of their neighbors
+    pool.parallelFor(0, remaining.size(), [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) {
+	  int v = remaining[i];
+	  bool lowest = true;
+	  for (const Arc &a : overlay.out[v]) { lowest = lowest && lower(v, a.target); }
+	  for (const Arc &a : overlay.in[v]) { lowest = lowest && lower(v, a.target); }
+	  selected[v] = lowest;
+	}
+      }, 256);
+
+    level.clear();
+    for (int v : remaining) {
+      if (selected[v]) {
+	level.push_back(v);
+	overlay.state[v] = CONTRACTING;
+      }
+    }
+
+    // Witness searches only read the overlay, so they run in parallel
+    pending.resize(level.size());
+    pool.parallelFor(0, level.size(), [&](size_t b, size_t e, unsigned id) {
+	for (size_t i = b; i < e; i++) {
+	  findShortcuts(overlay, level[i], SETTLE_LIMIT, workers[id]);
+	  pending[i].swap(workers[id].shortcuts);
+	}
+      }, 16);
+
+    touched.clear();
+    for (size_t i = 0; i < level.size(); i++) {
+      int v = level[i];
+      _rank[v] = nextRank++;
+
+      // The remaining neighbors all end up higher than v
+      for (const Arc &a : overlay.out[v]) {
+	dropArc(overlay.in[a.target], v);
+	deleted[a.target]++;
+	if (stamp[a.target] != round) { stamp[a.target] = round; touched.push_back(a.target); }
+      }
+      for (const Arc &a : overlay.in[v]) {
+	dropArc(overlay.out[a.target], v);
+	deleted[a.target]++;
+	if (stamp[a.target] != round) { stamp[a.target] = round; touched.push_back(a.target); }
+      }
+      up[v].swap(overlay.out[v]);
+      down[v].swap(overlay.in[v]);
+      overlay.state[v] = CONTRACTED;
+
+      for (const Shortcut &s : pending[i]) { addArc(overlay, s.from, s.to, s.weight, v); }
+      pending[i].clear();
+    }
+
+    // Only the neighbors of contracted nodes change priority
+    pool.parallelFor(0, touched.size(), [&](size_t b, size_t e, unsigned id) {
+	for (size_t i = b; i < e; i++) { prioritize(touched[i], workers[id]); }
+      }, 16);
+
+    remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [&](int v) {
+	  return overlay.state[v] == CONTRACTED;
+	}), remaining.end());
+  }
+
+  pack(up, _upOffsets, _up);
+  pack(down, _downOffsets, _down);
+}
+
+template<typename T>
+void ContractionHierarchy<T>::witnessSearch(const Overlay &g, int src, int skip, T limit,
+					    size_t maxSettled, Worker &w) {
+  w.ctx.reset(g.out.size());
+  w.heap.clear();
+
+  // Targets are marked PENDING until settled
+  size_t targets = 0;
+  for (const Arc &a : g.out[skip]) {
+    if (a.target != src) {
+      w.ctx.setState(a.target, PENDING);
+      targets++;
+    }
+  }
+
+  w.ctx.setDistance(src, (T) 0);
+  w.heap.push(src, (T) 0);
+
+  for (size_t settled = 0; !w.heap.empty() && settled < maxSettled && targets > 0; settled++) {
+    if (w.heap.topKey() > limit) { break; }
+    int top = w.heap.pop();
+    if (w.ctx.state(top) == PENDING) { targets--; }
+    w.ctx.setState(top, VISITED);
+
+    for (const Arc &a : g.out[top]) {
+      if (a.target == skip || g.state[a.target] != ALIVE) { continue; }
+      T dist = w.ctx.distance(top) + a.weight;
+      if (dist < w.ctx.distance(a.target)) {
+	w.ctx.setDistance(a.target, dist);
+	if (w.heap.contains(a.target)) { w.heap.decrease(a.target, dist); }
+	else { w.heap.push(a.target, dist); }
+      }
+    }
+  }
+}
+
+template<typename T>
+void ContractionHierarchy<T>::findShortcuts(const Overlay &g, int v, size_t maxSettled, Worker &w) {
+  w.shortcuts.clear();
+
+  for (const Arc &in : g.in[v]) {
+    int u = in.target;
+
+    T longest = 0;
+    bool any = false;
+    for (const Arc &out : g.out[v]) {
+      if (out.target != u) {
+	longest = std::max(longest, out.weight);
+	any = true;
+      }
+    }
+    if (!any) { continue; }
+
+    // A path no longer than the one through v makes the shortcut unnecessary
+    witnessSearch(g, u, v, in.weight + longest, maxSettled, w);
+    for (const Arc &out : g.out[v]) {
+      if (out.target != u && w.ctx.distance(out.target) > in.weight + out.weight) {
+	Shortcut s = { u, out.target, in.weight + out.weight };
+	w.shortcuts.push_back(s);
+      }
+    }
+  }
+}
+
+template<typename T>
+void ContractionHierarchy<T>::addArc(Overlay &g, int from, int to, T weight, int middle) {
+  for (Arc &a : g.out[from]) {
+    if (a.target != to) { continue; }
+    if (weight < a.weight) {
+      a.weight = weight;
+      a.middle = middle;
+      for (Arc &b : g.in[to]) {
+	if (b.target == from) {
+	  b.weight = weight;
+	  b.middle = middle;
+	}
+      }
+    }
+    return;
+  }
+
+  Arc out = { to, middle, weight }, in = { from, middle, weight };
+  g.out[from].push_back(out);
+  g.in[to].push_back(in);
+}
+
+template<typename T>
+void ContractionHierarchy<T>::pack(std::vector<std::vector<Arc> > &lists, std::vector<size_t> &offsets,
+				   std::vector<Arc> &arcs) {
+  offsets.assign(1, 0);
+  for (auto& l : lists) { offsets.push_back(offsets.back() + l.size()); }
+
+  arcs.clear();
+  arcs.reserve(offsets.back());
+  for (auto& l : lists) {
+    arcs.insert(arcs.end(), l.begin(), l.end());
+    std::vector<Arc>().swap(l); // frees the list before the next one is copied
+  }
+}
+
+template<typename T>
+const typename ContractionHierarchy<T>::Arc & ContractionHierarchy<T>::arc(int from, int to) const {
+  // Arcs up are stored with their start, arcs down with their end
+  bool upward = _rank[from] < _rank[to];
+  const std::vector<size_t> &offsets = upward ? _upOffsets : _downOffsets;
+  const std::vector<Arc> &arcs = upward ? _up : _down;
+  int owner = upward ? from : to, other = upward ? to : from;
+
+  for (size_t i = offsets[owner]; i < offsets[owner + 1]; i++) {
+    if (arcs[i].target == other) { return arcs[i]; }
+  }
+  throw std::logic_error("Hierarchy has no arc " + std::to_string(from) + " -> " + std::to_string(to));
+}
+
+template<typename T>
+T ContractionHierarchy<T>::search(int src, int dest, Query &q, int &meet) const {
+  for (int id : { src, dest }) {
+    if (id < 0 || (size_t) id >= size()) {
+      throw std::invalid_argument("Invalid Node ID - " + std::to_string(id));
+    }
+  }
+
+  const size_t n = size();
+  q._forward.reset(n);
+  q._backward.reset(n);
+  q._forwardQueue.clear();
+  q._forwardQueue.resize(n);
+  q._backwardQueue.clear();
+  q._backwardQueue.resize(n);
+
+  q._forward.setDistance(src, (T) 0);
+  q._forward.setParent(src, src);
+  q._forwardQueue.push(src, (T) 0);
+  q._backward.setDistance(dest, (T) 0);
+  q._backward.setParent(dest, dest);
+  q._backwardQueue.push(dest, (T) 0);
+
+  T best = Node<T>::INFINITY;
+  meet = -1;
+
+  /*
+   * Settles the closest node of one side. A node is stalled, i.e. its arcs
+   * are not relaxed, if an arc from a higher node reached by the same side
+   * shows that its distance is too long to be on a shortest path.
+   */
+  auto step = [&](QueryContext<T> &ctx, IndexedHeap<T> &queue, const QueryContext<T> &other,
+		  const std::vector<size_t> &offsets, const std::vector<Arc> &arcs,
+		  const std::vector<size_t> &stallOffsets, const std::vector<Arc> &stallArcs) {
+    int top = queue.pop();
+    ctx.setState(top, VISITED);
+    T dist = ctx.distance(top);
+
+    if (other.distance(top) != Node<T>::INFINITY && dist + other.distance(top) < best) {
+      best = dist + other.distance(top);
+      meet = top;
+    }
+
+    for (size_t i = stallOffsets[top]; i < stallOffsets[top + 1]; i++) {
+      T higher = ctx.distance(stallArcs[i].target);
+      if (higher != Node<T>::INFINITY && higher + stallArcs[i].weight < dist) { return; }
+    }
+
+    for (size_t i = offsets[top]; i < offsets[top + 1]; i++) {
+      const Arc &a = arcs[i];
+      T next = dist + a.weight;
+      if (next < ctx.distance(a.target)) {
+	ctx.setDistance(a.target, next);
+	ctx.setParent(a.target, top);
+	if (queue.contains(a.target)) { queue.decrease(a.target, next); }
+	else { queue.push(a.target, next); }
+      }
+    }
+  };
+
+  // Each side stops once its closest node is no closer than the best path
+  while (true) {
+    bool forward = !q._forwardQueue.empty() && q._forwardQueue.topKey() < best;
+    bool backward = !q._backwardQueue.empty() && q._backwardQueue.topKey() < best;
+    if (!forward && !backward) { break; }
+
+    if (forward && (!backward || q._forwardQueue.topKey() <= q._backwardQueue.topKey())) {
+      step(q._forward, q._forwardQueue, q._backward, _upOffsets, _up, _downOffsets, _down);
+    }
+    else {
+      step(q._backward, q._backwardQueue, q._forward, _downOffsets, _down, _upOffsets, _up);
+    }
+  }
+  return best;
+}
+
+template<typename T>
+std::vector<int> ContractionHierarchy<T>::path(int src, int dest, Query &q) const {
+  int meet;
+  std::vector<int> nodes;
+  if (search(src, dest, q, meet) == Node<T>::INFINITY) { return nodes; }
+
+  // Nodes of the path in the hierarchy: up from src to meet, then down to dest
+  std::vector<int> packed = q._forward.path(meet);
+  for (int id = meet; id != dest; ) {
+    id = q._backward.parent(id);
+    packed.push_back(id);
+  }
+
+  // Replaces every shortcut by the two arcs it skips, left one first
+  std::vector<std::pair<int, int> > stack;
+  nodes.push_back(src);
+  for (size_t i = packed.size() - 1; i > 0; i--) {
+    stack.push_back(std::make_pair(packed[i - 1], packed[i]));
+  }
+  while (!stack.empty()) {
+    std::pair<int, int> top = stack.back();
+    stack.pop_back();
+
+    const Arc &a = arc(top.first, top.second);
+    if (a.middle == -1) {
+      nodes.push_back(top.second);
+    }
+    else {
+      stack.push_back(std::make_pair(a.middle, top.second));
+      stack.push_back(std::make_pair(top.first, a.middle));
+    }
+  }
+  return nodes;
+}
+
+template<typename T>
+void ContractionHierarchy<T>::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out.good()) { throw std::runtime_error("Couldn't open file " + path); }
+
+  HierarchyHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "GRAPHCHR", 8);
+  header.version = VERSION;
+  header.weightSize = sizeof(T);
+  header.weightKind = Snapshot::kind<T>();
+  header.nNodes = size();
+  header.nUp = _up.size();
+  header.nDown = _down.size();
+
+  // Header is rewritten with the checksum once the arrays are out
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  uint64_t hash = Snapshot::checksum(nullptr, 0);
+  Snapshot::section(out, _rank.data(), size() * sizeof(int), hash);
+
+  for (int direction = 0; direction < 2; direction++) {
+    const std::vector<size_t> &offsets = direction ? _downOffsets : _upOffsets;
+    const std::vector<Arc> &arcs = direction ? _down : _up;
+
+    std::vector<int> targets, middles;
+    std::vector<T> weights;
+    for (const Arc &a : arcs) {
+      targets.push_back(a.target);
+      middles.push_back(a.middle);
+      weights.push_back(a.weight);
+    }
+    Snapshot::section(out, offsets.data(), offsets.size() * sizeof(size_t), hash);
+    Snapshot::section(out, targets.data(), arcs.size() * sizeof(int), hash);
+    Snapshot::section(out, middles.data(), arcs.size() * sizeof(int), hash);
+    Snapshot::section(out, weights.data(), arcs.size() * sizeof(T), hash);
+  }
+
+  header.checksum = hash;
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  if (!out.good()) { throw std::runtime_error("Couldn't write file " + path); }
+}
+
+template<typename T>
+ContractionHierarchy<T> ContractionHierarchy<T>::load(const std::string &path, bool verify) {
+  MappedFile file(path);
+  if (file.size() < sizeof(HierarchyHeader) || memcmp(file.data(), "GRAPHCHR", 8) != 0) {
+    throw std::runtime_error("Not a contraction hierarchy");
+  }
+
+  HierarchyHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+  if (header.version != VERSION) {
+    throw std::runtime_error("Unsupported hierarchy version - " + std::to_string(header.version));
+  }
+  if (header.weightSize != sizeof(T) || header.weightKind != Snapshot::kind<T>()) {
+    throw std::runtime_error("Hierarchy weight type does not match");
+  }
+
+  // With IDs limited to int, the node sections are small and the six arc
+  // sections, each at most an eighth of the address space, cannot overflow
+  if (header.nNodes > (uint64_t) std::numeric_limits<int>::max()) {
+    throw std::runtime_error("Hierarchy has too many nodes");
+  }
+  size_t n = header.nNodes, end = sizeof(HierarchyHeader) + Snapshot::bytes(n, sizeof(int));
+  for (uint64_t arcs : { header.nUp, header.nDown }) {
+    end += Snapshot::bytes(n, sizeof(size_t)) + sizeof(size_t) + 2 * Snapshot::bytes(arcs, sizeof(int))
+      + Snapshot::bytes(arcs, sizeof(T));
+  }
+  if (end != file.size()) {
+    throw std::runtime_error("Hierarchy is truncated");
+  }
+  if (verify && Snapshot::checksum(file.data() + sizeof(HierarchyHeader), file.size() - sizeof(HierarchyHeader))
+      != header.checksum) {
+    throw std::runtime_error("Hierarchy checksum mismatch");
+  }
+
+  // Copies a section out of the mapping and moves on to the next one
+  const char *p = file.data() + sizeof(HierarchyHeader);
+  auto read = [&](void *dest, size_t bytes) {
+    memcpy(dest, p, bytes);
+    p += Snapshot::padded(bytes);
+  };
+
+  ContractionHierarchy<T> ch;
+  ch._rank.resize(n);
+  read(ch._rank.data(), n * sizeof(int));
+
+  // Checked whether or not verify is set, since every query trusts them
+  for (size_t i = 0; i < n; i++) {
+    if (ch._rank[i] < -1 || ch._rank[i] >= (int) n) {
+      throw std::runtime_error("Hierarchy node " + std::to_string(i) + " has an invalid rank");
+    }
+  }
+
+  for (int direction = 0; direction < 2; direction++) {
+    std::vector<size_t> &offsets = direction ? ch._downOffsets : ch._upOffsets;
+    std::vector<Arc> &arcs = direction ? ch._down : ch._up;
+    size_t count = direction ? header.nDown : header.nUp;
+
+    std::vector<int> targets(count), middles(count);
+    std::vector<T> weights(count);
+    offsets.resize(n + 1);
+    read(offsets.data(), (n + 1) * sizeof(size_t));
+    read(targets.data(), count * sizeof(int));
+    read(middles.data(), count * sizeof(int));
+    read(weights.data(), count * sizeof(T));
+    if (offsets[0] != 0 || offsets[n] != count) { throw std::runtime_error("Hierarchy is corrupt"); }
+    for (size_t i = 0; i < n; i++) {
+      if (offsets[i] > offsets[i + 1]) {
+	throw std::runtime_error("Hierarchy offsets decrease at node " + std::to_string(i));
+      }
+    }
+
+    arcs.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      if (targets[i] < 0 || targets[i] >= (int) n || middles[i] < -1 || middles[i] >= (int) n) {
+	throw std::runtime_error("Hierarchy arc " + std::to_string(i) + " has an invalid node");
+      }
+      arcs[i].target = targets[i];
+      arcs[i].middle = middles[i];
+      arcs[i].weight = weights[i];
+    }
+  }
+  return ch;
+}
+
+#endif // _CONTRACTIONHIERARCHY_HH_
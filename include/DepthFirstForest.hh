@@ -0,0 +1,108 @@
+#ifndef _DEPTHFIRSTFOREST_HH_
+#define _DEPTHFIRSTFOREST_HH_
+
+#include <vector>
+
+#include "Stats.hh"
+
+/*
+ * Discovery time, finish time and parent of every node after a
+ * depth-first search, -1 for nodes that were not reached. Both times come
+ * from one clock, so the interval of a node nests inside the interval of
+ * every ancestor in the search tree. Roots are their own parent.
+ */
+struct DFSTree {
+  std::vector<int> discovery;
+  std::vector<int> finish;
+  std::vector<int> parent;
+  int time;
+
+  DFSTree() : discovery(), finish(), parent(), time(0) {}
+
+  // Clears the tree for a graph of n nodes
+  inline void reset(size_t n) {
+    discovery.assign(n, -1);
+    finish.assign(n, -1);
+    parent.assign(n, -1);
+    time = 0;
+  }
+};
+
+/*
+ * Callbacks of a depth-first search, which all do nothing. A visitor
+ * hides the ones it needs; it is a template parameter of the search, so
+ * every call is resolved and inlined at compile time.
+ *
+ * An edge into a node that was not discovered yet is a tree edge, into a
+ * node still on the stack a back edge, and into a finished node a forward
+ * or cross edge. An undirected edge is seen from both ends, so the edge
+ * back to the parent shows up as a back edge.
+ */
+struct DFSVisitor {
+  inline void discoverVertex(int) {}
+  inline void treeEdge(int, int) {}
+  inline void backEdge(int, int) {}
+  inline void forwardOrCrossEdge(int, int) {}
+  inline void finishVertex(int) {}
+};
+
+/*
+ * Searches depth-first from every node in [first, last) that the tree
+ * has not discovered yet, in order, continuing the tree's clock. The
+ * search keeps its own stack of nodes and edge positions, so it needs
+ * O(V) memory and cannot overflow the call stack on long paths. Settled
+ * nodes and scanned edges add to the stats of the calling algorithm,
+ * which starts them.
+ */
+template <class Graph_T, class Visitor>
+void DepthFirstForest(const Graph_T &g, int first, int last, DFSTree &tree, Visitor &visitor) {
+  typedef decltype(g.adjacent(g.node(0)).begin()) Iterator;
+
+  // Node being visited and its edges left to follow
+  struct Frame {
+    int id;
+    Iterator next;
+    Iterator end;
+  };
+  std::vector<Frame> calls;
+
+  auto discover = [&](int id) {
+    tree.discovery[id] = tree.time++;
+    GRAPH_COUNT(settled);
+    visitor.discoverVertex(id);
+    const auto& edges = g.adjacent(g.node(id));
+    Frame f = { id, edges.begin(), edges.end() };
+    calls.push_back(f);
+  };
+
+  for (int src = first; src < last; src++) {
+    if (g.node(src) == nullptr || tree.discovery[src] != -1) { continue; }
+    tree.parent[src] = src;
+    discover(src);
+
+    while (!calls.empty()) {
+      Frame &top = calls.back();
+
+      if (top.next != top.end) {
+	int from = top.id, to = (*top.next)->getEnd()->getID();
+	++top.next;
+	GRAPH_COUNT(scanned);
+	if (tree.discovery[to] == -1) { // top is invalid once to is pushed
+	  tree.parent[to] = from;
+	  visitor.treeEdge(from, to);
+	  discover(to);
+	}
+	else if (tree.finish[to] == -1) { visitor.backEdge(from, to); }
+	else { visitor.forwardOrCrossEdge(from, to); }
+	continue;
+      }
+
+      int id = top.id;
+      calls.pop_back();
+      tree.finish[id] = tree.time++;
+      visitor.finishVertex(id);
+    }
+  }
+}
+
+#endif // _DEPTHFIRSTFOREST_HH_
@@ -0,0 +1,286 @@
+#ifndef _DYNAMICSSSP_HH_
+#define _DYNAMICSSSP_HH_
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Node.hh"
+#include "IndexedHeap.hh"
+#include "AdjacencyList.hh"
+
+/*
+ * Shortest paths from one source that are kept up to date while the graph
+ * changes. Edges are added and removed through this object, which forwards
+ * the change to the graph and then repairs only the part of the shortest
+ * path tree it affects, in the style of Ramalingam and Reps:
+ *
+ *  - an added edge that shortens a path seeds a Dijkstra search from its
+ *    end node, which stops where distances no longer improve;
+ *  - a removed tree edge invalidates the subtree below it; every node of
+ *    the subtree takes its best distance over incoming edges from outside
+ *    the subtree, and a Dijkstra search within the subtree settles the rest.
+ *
+ * Both cost time proportional to the edges of the nodes whose distance
+ * changes. Removals need the incoming edges of a node, so the graph's
+ * incoming-edge index is turned on if it is not already. Edge weights must
+ * not be negative.
+ */
+template <typename T, class Graph_T = AdjacencyList<T> >
+class DynamicSSSP {
+
+private:
+  Graph_T &_graph;
+  int _src;
+
+  std::vector<T> _dist; // INFINITY if not reached
+  std::vector<int> _prev; // predecessor ID, -1 if not reached, src for src
+
+  IndexedHeap<T> _heap; // nodes whose distance changed and are not settled yet
+
+  std::vector<int> _affected; // subtree being repaired
+  std::vector<bool> _inAffected;
+
+  DynamicSSSP() = delete; // Removes default constructor
+
+  // Grows the state after nodes were added to the graph
+  void resize();
+
+  // Offers a path through from to to, queueing to if it gets shorter
+  inline void relax(int from, int to, T weight) {
+    if (_dist[from] == Node<T>::INFINITY) { return; }
+    T dist = _dist[from] + weight;
+    if (dist < _dist[to]) {
+      _dist[to] = dist;
+      _prev[to] = from;
+      if (_heap.contains(to)) { _heap.decrease(to, dist); }
+      else { _heap.push(to, dist); }
+    }
+  }
+
+  // Settles the queued nodes, relaxing the edges out of each one
+  void propagate();
+
+  // Collects root and every node below it in the shortest path tree into _affected
+  void collectSubtree(int root);
+
+  // Gives every node of _affected its best distance from outside the subtree,
+  // then settles the subtree
+  void repairSubtree();
+
+  // Repairs the subtree below to if the tree edge into it got longer, as
+  // when an AdjacencyMatrix replaces an edge
+  void recheckTreeEdge(int from, int to);
+
+  static inline void checkWeight(T weight) {
+    if (weight < 0) {
+      throw std::runtime_error("Error: Negative Edge Weight - " + std::to_string(weight));
+    }
+  }
+
+public:
+  // Computes the shortest paths from src in g, which must outlive this object
+  DynamicSSSP(Graph_T &g, int src);
+
+  DynamicSSSP(const DynamicSSSP &other) = delete;
+  DynamicSSSP & operator=(const DynamicSSSP &other) = delete;
+
+  inline int source() const { return _src; }
+  inline const Graph_T & graph() const { return _graph; }
+
+  // Returns the distance from the source, INFINITY if id is not reachable
+  inline T distance(int id) const {
+    return ((size_t) id < _dist.size()) ? _dist[id] : Node<T>::INFINITY;
+  }
+
+  // Returns the predecessor of id on its shortest path, -1 if not reachable
+  inline int parent(int id) const {
+    return ((size_t) id < _prev.size()) ? _prev[id] : -1;
+  }
+
+  // Returns the node IDs from the source to dest, or an empty path if dest
+  // is not reachable
+  std::vector<int> path(int dest) const;
+
+  // Adds an edge to the graph (both directions if undirected) and shortens
+  // the paths that can use it
+  void addEdge(int from, int to, T weight);
+
+  // Removes every edge from from to to (and back if undirected) and
+  // reroutes the paths that used one
+  void removeEdge(int from, int to);
+
+  // Replaces every edge from from to to (and back if undirected) with one of the given weight
+  void setWeight(int from, int to, T weight);
+
+  // Adds a node to the graph, unreachable until an edge leads to it
+  void addNode(int id);
+
+  // Removes a node and its edges from the graph, rerouting the paths
+  // through it. The source cannot be removed.
+  void removeNode(int id);
+};
+
+template<typename T, class Graph_T>
+DynamicSSSP<T, Graph_T>::DynamicSSSP(Graph_T &g, int src)
+  : _graph(g), _src(src), _dist(), _prev(), _heap(), _affected(), _inAffected() {
+
+  if (src < 0 || (size_t) src >= g.size() || g.node(src) == nullptr) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(src));
+  }
+  if (!_graph.tracksIncoming()) { _graph.trackIncoming(); }
+
+  resize();
+  _dist[src] = (T) 0;
+  _prev[src] = src;
+  _heap.push(src, (T) 0);
+  propagate();
+}
+
+template<typename T, class Graph_T>
+inline void DynamicSSSP<T, Graph_T>::resize() {
+  const size_t n = _graph.size();
+  if (n > _dist.size()) {
+    _dist.resize(n, Node<T>::INFINITY);
+    _prev.resize(n, -1);
+    _inAffected.resize(n, false);
+    _heap.resize(n);
+  }
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::propagate() {
+  while (!_heap.empty()) {
+    int top = _heap.pop();
+    for (auto& edge : _graph.adjacent(_graph.node(top))) {
+      checkWeight(edge->getWeight());
+      relax(top, edge->getEnd()->getID(), edge->getWeight());
+    }
+  }
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::collectSubtree(int root) {
+  _affected.clear();
+  _affected.push_back(root);
+  _inAffected[root] = true;
+
+  // Children are found through tree edges, so no child lists are kept
+  for (size_t i = 0; i < _affected.size(); i++) {
+    int id = _affected[i];
+    if (_graph.node(id) == nullptr) { continue; }
+    for (auto& edge : _graph.adjacent(_graph.node(id))) {
+      int child = edge->getEnd()->getID();
+      if (_prev[child] == id && child != id && !_inAffected[child]) {
+	_inAffected[child] = true;
+	_affected.push_back(child);
+      }
+    }
+  }
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::repairSubtree() {
+  for (int id : _affected) {
+    _dist[id] = Node<T>::INFINITY;
+    _prev[id] = -1;
+  }
+
+  // Distances outside the subtree did not change, so they seed the search
+  for (int id : _affected) {
+    if (_graph.node(id) == nullptr) { continue; }
+    for (auto& edge : _graph.incoming(_graph.node(id))) {
+      int from = edge->getStart()->getID();
+      if (!_inAffected[from]) { relax(from, id, edge->getWeight()); }
+    }
+  }
+
+  for (int id : _affected) { _inAffected[id] = false; }
+  propagate();
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::recheckTreeEdge(int from, int to) {
+  if (_prev[to] != from || to == _src) { return; }
+
+  T best = Node<T>::INFINITY;
+  for (auto& edge : _graph.adjacent(_graph.node(from))) {
+    if (edge->getEnd()->getID() == to) { best = std::min(best, edge->getWeight()); }
+  }
+  if (_dist[from] + best > _dist[to]) {
+    collectSubtree(to);
+    repairSubtree();
+  }
+}
+
+template<typename T, class Graph_T>
+std::vector<int> DynamicSSSP<T, Graph_T>::path(int dest) const {
+  std::vector<int> nodes;
+  if (parent(dest) == -1) { return nodes; } // unreachable
+
+  nodes.push_back(dest);
+  while (_prev[nodes.back()] != nodes.back()) { // source is its own parent
+    nodes.push_back(_prev[nodes.back()]);
+  }
+
+  std::reverse(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::addEdge(int from, int to, T weight) {
+  checkWeight(weight);
+  _graph.addEdge(from, to, weight);
+  resize();
+
+  recheckTreeEdge(from, to);
+  if (!_graph.isDirected()) { recheckTreeEdge(to, from); }
+
+  relax(from, to, weight);
+  if (!_graph.isDirected()) { relax(to, from, weight); }
+  propagate();
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::removeEdge(int from, int to) {
+  _graph.removeEdge(from, to);
+
+  // Only a tree edge changes any distance; at most one direction can be one
+  int root = -1;
+  if (_prev[to] == from && to != _src) { root = to; }
+  else if (!_graph.isDirected() && _prev[from] == to && from != _src) { root = from; }
+  if (root == -1) { return; }
+
+  collectSubtree(root);
+  repairSubtree();
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::setWeight(int from, int to, T weight) {
+  checkWeight(weight);
+  removeEdge(from, to);
+  addEdge(from, to, weight);
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::addNode(int id) {
+  _graph.addNode(id);
+  resize();
+}
+
+template<typename T, class Graph_T>
+void DynamicSSSP<T, Graph_T>::removeNode(int id) {
+  if (id == _src) {
+    throw std::invalid_argument("Cannot remove the source node - " + std::to_string(id));
+  }
+  if (id < 0 || (size_t) id >= _graph.size() || _graph.node(id) == nullptr) { return; }
+
+  // The subtree is found through the node's edges, so before they are gone
+  bool reached = (_prev[id] != -1);
+  if (reached) { collectSubtree(id); }
+  _graph.removeNode(id);
+  if (reached) { repairSubtree(); }
+}
+
+#endif // _DYNAMICSSSP_HH_
@@ -21,8 +21,10 @@ private:
 
 public:
   Edge(Node<T> *s, Node<T> *e, T w = (T)0) : _start(s), _end(e), _weight(w) {}
+  Edge(const Edge &other) = default;
+  Edge & operator=(const Edge &other) = default;
   
-  ~Edge() {}
+  ~Edge() = default;
 
   inline Node<T>* getStart() const { return _start; }
   inline Node<T>* getEnd() const { return _end; }
@@ -33,6 +35,34 @@ public:
 template<typename T>
 using EdgePtr = std::shared_ptr<Edge<T> >;
 
+/*
+ * Non-owning view of an edge, used by representations that do not store
+ * Edge objects. Dereferences like an EdgePtr, so algorithms can write
+ * edge->getEnd() regardless of the graph type.
+ */
+template <typename T>
+class EdgeRef {
+
+private:
+  Node<T> *_start;
+  Node<T> *_end;
+
+  T _weight;
+
+public:
+  EdgeRef() : _start(nullptr), _end(nullptr), _weight((T)0) {}
+  EdgeRef(Node<T> *s, Node<T> *e, T w) : _start(s), _end(e), _weight(w) {}
+  EdgeRef(const EdgeRef &other) = default;
+  EdgeRef & operator=(const EdgeRef &other) = default;
+
+  inline Node<T>* getStart() const { return _start; }
+  inline Node<T>* getEnd() const { return _end; }
+
+  inline T getWeight() const { return _weight; }
+
+  inline const EdgeRef * operator->() const { return this; }
+};
+
 #endif // _EDGE_HH_
 
   
@@ -0,0 +1,285 @@
+#ifndef _EDGEREADER_HH_
+#define _EDGEREADER_HH_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+#include "MappedFile.hh"
+#include "ThreadPool.hh"
+
+/*
+ * Reads edges in the text format of the graph constructors:
+ * numNodes numEdges
+ * startID endID edgeWeight // Edge 1
+ * ...
+ * Files are memory-mapped and split into chunks at line boundaries that
+ * are parsed in parallel, with a hand-written number parser in place of
+ * formatted stream extraction. Like the stream version, reading stops at
+ * the first edge that does not parse.
+ */
+template <typename T>
+class EdgeReader {
+
+private:
+  size_t _nNodes; // header count, raised to cover every ID that appears
+  std::vector<int> _from; // start node ID of every edge
+  std::vector<int> _to; // end node ID of every edge
+  std::vector<T> _weight; // weight of every edge
+
+  static const size_t MIN_CHUNK = 1 << 20; // bytes per chunk before splitting pays off
+
+  // Edges parsed from one chunk of the input
+  struct Chunk {
+    std::vector<int> from;
+    std::vector<int> to;
+    std::vector<T> weight;
+    int maxID;
+    bool failed; // stopped at an edge that does not parse
+
+    Chunk() : from(), to(), weight(), maxID(-1), failed(false) {}
+  };
+
+  static inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  // A number must be followed by whitespace or the end of the input
+  static inline bool atBoundary(const char *p, const char *end) { return p == end || isSpace(*p); }
+
+  static inline void skipSpace(const char *&p, const char *end) {
+    while (p != end && isSpace(*p)) { ++p; }
+  }
+
+  // Parses an integer at p, advancing p past it; fails if its magnitude does not fit in Int
+  template<typename Int>
+  static bool parseInteger(const char *&p, const char *end, Int &value);
+
+  // Parses a decimal or scientific real number at p, advancing p past it
+  static bool parseReal(const char *&p, const char *end, T &value);
+
+  static inline bool parseWeight(const char *&p, const char *end, T &value, std::true_type) {
+    return parseReal(p, end, value);
+  }
+  static inline bool parseWeight(const char *&p, const char *end, T &value, std::false_type) {
+    return parseInteger(p, end, value);
+  }
+
+  // Parses the edges in [p, end) into chunk, expecting about expected of them
+  static void parseChunk(const char *p, const char *end, size_t expected, Chunk &chunk);
+
+  // Parses a whole input held in memory
+  void parse(const char *first, const char *last, unsigned threads);
+
+  EdgeReader() = delete; // Removes default constructor
+
+public:
+  // Reads a file through a memory mapping
+  explicit EdgeReader(const std::string &path, unsigned threads = ThreadPool::hardwareThreads());
+
+  // Reads the rest of a stream
+  explicit EdgeReader(std::istream &input, unsigned threads = ThreadPool::hardwareThreads());
+
+  // Returns number of nodes, i.e. one more than the largest node ID
+  inline size_t numNodes() const { return _nNodes; }
+
+  // Returns number of edges read
+  inline size_t numEdges() const { return _from.size(); }
+
+  inline const std::vector<int> & from() const { return _from; }
+  inline const std::vector<int> & to() const { return _to; }
+  inline const std::vector<T> & weight() const { return _weight; }
+};
+
+template<typename T>
+const size_t EdgeReader<T>::MIN_CHUNK;
+
+template<typename T>
+EdgeReader<T>::EdgeReader(const std::string &path, unsigned threads)
+  : _nNodes(0), _from(), _to(), _weight() {
+
+  MappedFile file(path);
+  parse(file.data(), file.data() + file.size(), threads);
+}
+
+template<typename T>
+EdgeReader<T>::EdgeReader(std::istream &input, unsigned threads)
+  : _nNodes(0), _from(), _to(), _weight() {
+
+  std::ostringstream buffer;
+  buffer << input.rdbuf();
+  const std::string text = buffer.str();
+  parse(text.data(), text.data() + text.size(), threads);
+}
+
+template<typename T>
+template<typename Int>
+inline bool EdgeReader<T>::parseInteger(const char *&p, const char *end, Int &value) {
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  if (p == end || !isDigit(*p)) { return false; }
+
+  typedef typename std::make_unsigned<Int>::type Unsigned;
+  const Unsigned limit = std::numeric_limits<Int>::max();
+  Unsigned magnitude = 0;
+  while (p != end && isDigit(*p)) {
+    Unsigned digit = *p - '0';
+    if (magnitude > (limit - digit) / 10) { return false; } // like a stream, stops instead of wrapping
+    magnitude = magnitude * 10 + digit;
+    ++p;
+  }
+  value = negative ? (Int) (0 - magnitude) : (Int) magnitude;
+  return atBoundary(p, end);
+}
+
+template<typename T>
+inline bool EdgeReader<T>::parseReal(const char *&p, const char *end, T &value) {
+  // Powers of ten that doubles represent exactly
+  static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  const char *token = p;
+
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  uint64_t mantissa = 0; // up to 19 significant digits
+  int digits = 0, exponent = 0;
+  bool any = false, exact = true;
+  for (bool fraction = false; p != end; ++p) {
+    if (*p == '.' && !fraction) { fraction = true; continue; }
+    if (!isDigit(*p)) { break; }
+
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0) { digits++; }
+      if (fraction) { exponent--; }
+    }
+    else {
+      if (*p != '0') { exact = false; } // dropped a significant digit
+      if (!fraction) { exponent++; }
+    }
+  }
+  if (!any) { return false; }
+
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    int e;
+    if (!parseInteger(++p, end, e)) { return false; }
+    exponent += e;
+  }
+  else if (!atBoundary(p, end)) { return false; }
+
+  double result;
+  if (exact && mantissa <= ((uint64_t) 1 << 53) && exponent >= -22 && exponent <= 22) {
+    // Both operands are exact, so one correctly rounded operation is exact enough
+    result = (double) mantissa;
+    result = (exponent < 0) ? result / pow10[-exponent] : result * pow10[exponent];
+    if (negative) { result = -result; }
+  }
+  else { // rare: long mantissas or large exponents
+    result = strtod(std::string(token, p).c_str(), nullptr);
+  }
+  value = (T) result;
+  return true;
+}
+
+template<typename T>
+void EdgeReader<T>::parseChunk(const char *p, const char *end, size_t expected, Chunk &chunk) {
+  expected = std::min(expected, (size_t) (end - p) / 6 + 1); // an edge takes at least 6 bytes
+  chunk.from.reserve(expected);
+  chunk.to.reserve(expected);
+  chunk.weight.reserve(expected);
+
+  int from, to;
+  T weight;
+  while (true) {
+    skipSpace(p, end);
+    if (p == end) { return; }
+
+    if (!parseInteger(p, end, from) || from < 0) { break; }
+    skipSpace(p, end);
+    if (!parseInteger(p, end, to) || to < 0) { break; }
+    skipSpace(p, end);
+    if (!parseWeight(p, end, weight, std::is_floating_point<T>())) { break; }
+
+    chunk.from.push_back(from);
+    chunk.to.push_back(to);
+    chunk.weight.push_back(weight);
+    chunk.maxID = std::max(chunk.maxID, std::max(from, to));
+  }
+  chunk.failed = true;
+}
+
+template<typename T>
+void EdgeReader<T>::parse(const char *first, const char *last, unsigned threads) {
+  const char *p = first;
+  size_t nEdges = 0;
+
+  skipSpace(p, last);
+  if (!parseInteger(p, last, _nNodes)) { _nNodes = 0; return; }
+  skipSpace(p, last);
+  if (!parseInteger(p, last, nEdges)) { return; }
+
+  // Splits the edge lines into chunks at line boundaries
+  size_t bytes = last - p;
+  size_t nChunks = std::max((size_t) 1, std::min((size_t) threads * 4, bytes / MIN_CHUNK));
+  std::vector<const char *> bounds(nChunks + 1, last);
+  bounds[0] = p;
+  for (size_t i = 1; i < nChunks; i++) {
+    const char *split = std::find(std::max(p + bytes * i / nChunks, bounds[i - 1]), last, '\n');
+    bounds[i] = (split == last) ? last : split + 1;
+  }
+
+  // The header edge count sizes every chunk by its share of the bytes
+  auto expected = [&](size_t i) { return (size_t) ((double) nEdges * (bounds[i + 1] - bounds[i]) / bytes) + 1; };
+
+  std::vector<Chunk> chunks(nChunks);
+  if (nChunks == 1) {
+    parseChunk(bounds[0], bounds[1], nEdges, chunks[0]);
+  }
+  else {
+    ThreadPool pool(std::min((size_t) threads, nChunks));
+    pool.parallelFor(0, nChunks, [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) { parseChunk(bounds[i], bounds[i + 1], expected(i), chunks[i]); }
+      }, 1);
+  }
+
+  // Keeps the edges up to the first one that does not parse
+  size_t total = 0, used = nChunks;
+  for (size_t i = 0; i < nChunks; i++) {
+    total += chunks[i].from.size();
+    if (chunks[i].failed) { used = i + 1; break; }
+  }
+
+  _from.reserve(total);
+  _to.reserve(total);
+  _weight.reserve(total);
+  int maxID = -1;
+  for (size_t i = 0; i < used; i++) {
+    Chunk &c = chunks[i];
+    _from.insert(_from.end(), c.from.begin(), c.from.end());
+    _to.insert(_to.end(), c.to.begin(), c.to.end());
+    _weight.insert(_weight.end(), c.weight.begin(), c.weight.end());
+    maxID = std::max(maxID, c.maxID);
+    c = Chunk(); // frees the chunk before the next one is copied
+  }
+
+  _nNodes = std::max(_nNodes, (size_t) maxID + 1);
+}
+
+#endif // _EDGEREADER_HH_
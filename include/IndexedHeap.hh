@@ -0,0 +1,146 @@
+#ifndef _INDEXEDHEAP_HH_
+#define _INDEXEDHEAP_HH_
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+// Default arity of the heap; build with e.g. -D GRAPH_HEAP_ARITY=8 to compare layouts
+#ifndef GRAPH_HEAP_ARITY
+#define GRAPH_HEAP_ARITY 4
+#endif
+
+/*
+ * Addressable d-ary min-heap of node IDs, keyed by distance. Every ID is in
+ * the heap at most once and its key can be lowered in place, so a shortest
+ * path search never holds more than |V| entries.
+ */
+template <typename T, unsigned D = GRAPH_HEAP_ARITY>
+class IndexedHeap {
+
+private:
+  struct Entry {
+    T key;
+    int id;
+  };
+
+  std::vector<Entry> _heap; // entries in heap order
+  std::vector<int> _pos; // index of each ID in _heap, -1 if not in the heap
+
+  static_assert(D >= 2, "Heap arity must be at least 2");
+
+  inline void place(size_t i, const Entry &e) {
+    _heap[i] = e;
+    _pos[e.id] = i;
+  }
+
+  // Moves the entry at i towards the root until its parent is smaller
+  void siftUp(size_t i);
+
+  // Moves the entry at i towards the leaves until its children are larger
+  void siftDown(size_t i);
+
+public:
+  IndexedHeap(size_t n = 0) : _heap(), _pos(n, -1) {}
+
+  // Allows IDs up to n - 1
+  inline void resize(size_t n) {
+    if (n > _pos.size()) { _pos.resize(n, -1); }
+  }
+
+  inline bool empty() const { return _heap.empty(); }
+  inline size_t size() const { return _heap.size(); }
+
+  inline bool contains(int id) const { return _pos[id] != -1; }
+
+  // Returns the ID and key with the smallest key
+  inline int top() const { return _heap.front().id; }
+  inline T topKey() const { return _heap.front().key; }
+
+  // Adds an ID that is not in the heap
+  void push(int id, T key);
+
+  // Lowers the key of an ID already in the heap
+  void decrease(int id, T key);
+
+  // Removes and returns the ID with the smallest key
+  int pop();
+
+  // Empties the heap in time proportional to its size
+  void clear();
+};
+
+template<typename T, unsigned D>
+void IndexedHeap<T, D>::siftUp(size_t i) {
+  Entry e = _heap[i];
+  while (i > 0) {
+    size_t parent = (i - 1) / D;
+    if (!(e.key < _heap[parent].key)) { break; }
+    place(i, _heap[parent]);
+    i = parent;
+  }
+  place(i, e);
+}
+
+template<typename T, unsigned D>
+void IndexedHeap<T, D>::siftDown(size_t i) {
+  Entry e = _heap[i];
+  size_t n = _heap.size();
+  while (true) {
+    size_t first = D * i + 1;
+    if (first >= n) { break; }
+
+    size_t last = std::min(first + D, n), best = first;
+    for (size_t c = first + 1; c < last; c++) {
+      if (_heap[c].key < _heap[best].key) { best = c; }
+    }
+    if (!(_heap[best].key < e.key)) { break; }
+
+    place(i, _heap[best]);
+    i = best;
+  }
+  place(i, e);
+}
+
+template<typename T, unsigned D>
+inline void IndexedHeap<T, D>::push(int id, T key) {
+  Entry e = { key, id };
+  _heap.push_back(e);
+  _pos[id] = _heap.size() - 1;
+  siftUp(_heap.size() - 1);
+}
+
+template<typename T, unsigned D>
+inline void IndexedHeap<T, D>::decrease(int id, T key) {
+  size_t i = _pos[id];
+  if (_heap[i].key < key) {
+    throw std::invalid_argument("Key can only be decreased - " + std::to_string(id));
+  }
+  _heap[i].key = key;
+  siftUp(i);
+}
+
+template<typename T, unsigned D>
+inline int IndexedHeap<T, D>::pop() {
+  int id = _heap.front().id;
+  _pos[id] = -1;
+
+  Entry last = _heap.back();
+  _heap.pop_back();
+  if (!_heap.empty()) {
+    place(0, last);
+    siftDown(0);
+  }
+  return id;
+}
+
+template<typename T, unsigned D>
+inline void IndexedHeap<T, D>::clear() {
+  for (auto& e : _heap) {
+    _pos[e.id] = -1;
+  }
+  _heap.clear();
+}
+
+#endif // _INDEXEDHEAP_HH_
@@ -0,0 +1,59 @@
+#ifndef _MAPPEDFILE_HH_
+#define _MAPPEDFILE_HH_
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Read-only memory mapping of a whole file, unmapped on destruction
+ */
+class MappedFile {
+
+private:
+  const char *_data;
+  size_t _size;
+
+  MappedFile() = delete; // Removes default constructor
+
+public:
+  explicit MappedFile(const std::string &path) : _data(nullptr), _size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) { throw std::runtime_error("Couldn't open file " + path); }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      throw std::runtime_error("Couldn't open file " + path);
+    }
+
+    _size = info.st_size;
+    if (_size > 0) {
+      void *addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+	close(fd);
+	throw std::runtime_error("Couldn't map file " + path);
+      }
+      madvise(addr, _size, MADV_SEQUENTIAL);
+      _data = static_cast<const char *>(addr);
+    }
+    close(fd); // the mapping stays valid without the descriptor
+  }
+
+  MappedFile(const MappedFile &other) = delete;
+  MappedFile & operator=(const MappedFile &other) = delete;
+
+  ~MappedFile() {
+    if (_data != nullptr) { munmap(const_cast<char *>(_data), _size); }
+  }
+
+  inline const char * data() const { return _data; }
+  inline size_t size() const { return _size; }
+};
+
+#endif // _MAPPEDFILE_HH_
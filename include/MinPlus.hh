@@ -0,0 +1,117 @@
+#ifndef _MINPLUS_HH_
+#define _MINPLUS_HH_
+
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "Node.hh"
+
+/*
+ * Min-plus row update used by the all-pairs shortest path kernels:
+ *   c[j] = min(c[j], a + b[j])   for j in [0, len)
+ * where INFINITY saturates, i.e. x + INFINITY stays INFINITY. Callers skip
+ * rows where a itself is INFINITY.
+ */
+template <typename T>
+inline void minPlusScalar(T *c, const T *b, T a, size_t len) {
+  for (size_t j = 0; j < len; j++) {
+    if (b[j] != Node<T>::INFINITY && a + b[j] < c[j]) {
+      c[j] = a + b[j];
+    }
+  }
+}
+
+/*
+ * Generic min-plus kernel. float, double and int have SSE2/AVX2 versions
+ * below when the compiler targets them (e.g. make ARCH=-mavx2).
+ */
+template <typename T>
+struct MinPlus {
+  static inline void update(T *c, const T *b, T a, size_t len) {
+    minPlusScalar(c, b, a, len);
+  }
+};
+
+#if defined(__AVX2__)
+
+template <>
+struct MinPlus<float> {
+  static inline void update(float *c, const float *b, float a, size_t len) {
+    const __m256 va = _mm256_set1_ps(a), inf = _mm256_set1_ps(Node<float>::INFINITY);
+    size_t j = 0;
+    for (; j + 8 <= len; j += 8) {
+      __m256 vb = _mm256_loadu_ps(b + j);
+      __m256 sum = _mm256_blendv_ps(_mm256_add_ps(va, vb), inf, _mm256_cmp_ps(vb, inf, _CMP_EQ_OQ));
+      _mm256_storeu_ps(c + j, _mm256_min_ps(_mm256_loadu_ps(c + j), sum));
+    }
+    minPlusScalar(c + j, b + j, a, len - j);
+  }
+};
+
+template <>
+struct MinPlus<double> {
+  static inline void update(double *c, const double *b, double a, size_t len) {
+    const __m256d va = _mm256_set1_pd(a), inf = _mm256_set1_pd(Node<double>::INFINITY);
+    size_t j = 0;
+    for (; j + 4 <= len; j += 4) {
+      __m256d vb = _mm256_loadu_pd(b + j);
+      __m256d sum = _mm256_blendv_pd(_mm256_add_pd(va, vb), inf, _mm256_cmp_pd(vb, inf, _CMP_EQ_OQ));
+      _mm256_storeu_pd(c + j, _mm256_min_pd(_mm256_loadu_pd(c + j), sum));
+    }
+    minPlusScalar(c + j, b + j, a, len - j);
+  }
+};
+
+template <>
+struct MinPlus<int> {
+  static inline void update(int *c, const int *b, int a, size_t len) {
+    const __m256i va = _mm256_set1_epi32(a), inf = _mm256_set1_epi32(Node<int>::INFINITY);
+    size_t j = 0;
+    for (; j + 8 <= len; j += 8) {
+      __m256i vb = _mm256_loadu_si256((const __m256i *) (b + j));
+      __m256i sum = _mm256_blendv_epi8(_mm256_add_epi32(va, vb), inf, _mm256_cmpeq_epi32(vb, inf));
+      __m256i vc = _mm256_loadu_si256((const __m256i *) (c + j));
+      _mm256_storeu_si256((__m256i *) (c + j), _mm256_min_epi32(vc, sum));
+    }
+    minPlusScalar(c + j, b + j, a, len - j);
+  }
+};
+
+#elif defined(__SSE2__)
+
+template <>
+struct MinPlus<float> {
+  static inline void update(float *c, const float *b, float a, size_t len) {
+    const __m128 va = _mm_set1_ps(a), inf = _mm_set1_ps(Node<float>::INFINITY);
+    size_t j = 0;
+    for (; j + 4 <= len; j += 4) {
+      __m128 vb = _mm_loadu_ps(b + j);
+      __m128 isInf = _mm_cmpeq_ps(vb, inf);
+      __m128 sum = _mm_or_ps(_mm_and_ps(isInf, inf), _mm_andnot_ps(isInf, _mm_add_ps(va, vb)));
+      _mm_storeu_ps(c + j, _mm_min_ps(_mm_loadu_ps(c + j), sum));
+    }
+    minPlusScalar(c + j, b + j, a, len - j);
+  }
+};
+
+template <>
+struct MinPlus<double> {
+  static inline void update(double *c, const double *b, double a, size_t len) {
+    const __m128d va = _mm_set1_pd(a), inf = _mm_set1_pd(Node<double>::INFINITY);
+    size_t j = 0;
+    for (; j + 2 <= len; j += 2) {
+      __m128d vb = _mm_loadu_pd(b + j);
+      __m128d isInf = _mm_cmpeq_pd(vb, inf);
+      __m128d sum = _mm_or_pd(_mm_and_pd(isInf, inf), _mm_andnot_pd(isInf, _mm_add_pd(va, vb)));
+      _mm_storeu_pd(c + j, _mm_min_pd(_mm_loadu_pd(c + j), sum));
+    }
+    minPlusScalar(c + j, b + j, a, len - j);
+  }
+};
+
+#endif
+
+#endif // _MINPLUS_HH_
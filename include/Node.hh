@@ -2,6 +2,8 @@
 #define _NODE_HH_
 
 #include <limits>
+#include <string>
+#include <stdexcept>
 
 enum STATUS { VISITED, PENDING, NOT_VISITED }; // Defines possible states of node
 
@@ -23,7 +25,7 @@ public:
   static constexpr const T INFINITY = std::numeric_limits<T>::max();
  
   Node(int id) : _id(id),  _weight(INFINITY), _state(NOT_VISITED) {}
-  ~Node() {}
+  ~Node() = default;
   
   inline int getID() const { return _id; }
 
@@ -34,4 +36,19 @@ public:
   inline void setState(STATUS s) { _state = s; }
 };
 
+// Definition for when INFINITY is bound to a reference, e.g. as a fill value
+template <typename T>
+constexpr const T Node<T>::INFINITY;
+
+/*
+ * Throws unless id is the ID of a node of the graph, so that a search from
+ * a missing node fails instead of following a null node
+ */
+template <class Graph_T>
+inline void requireNode(const Graph_T &g, int id) {
+  if (id < 0 || (size_t) id >= g.size() || g.node(id) == nullptr) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(id));
+  }
+}
+
 #endif // _NODE_HH_
@@ -0,0 +1,113 @@
+#ifndef _QUERYCONTEXT_HH_
+#define _QUERYCONTEXT_HH_
+
+#include <vector>
+#include <algorithm>
+
+#include "Node.hh"
+
+/*
+ * Holds the state of one traversal (visit state, distance and predecessor of
+ * every node) outside of the graph, so that any number of queries can run
+ * against the same read-only graph at once, one context per thread.
+ *
+ * Entries are stamped with the epoch of the query that last wrote them, and
+ * an entry with a stale stamp reads as NOT_VISITED / INFINITY / no parent.
+ * Starting a new query therefore costs O(1) instead of O(|V|).
+ */
+template <typename T>
+class QueryContext {
+
+private:
+  std::vector<unsigned> _stamp; // epoch in which each entry was last written
+  std::vector<STATUS> _state;
+  std::vector<T> _dist;
+  std::vector<int> _prev; // predecessor ID, -1 if none
+
+  std::vector<int> _order; // order in which the query visited the nodes
+
+  unsigned _epoch;
+
+  // Brings an entry up to the current epoch, clearing what an old query left
+  inline void touch(int id) {
+    if (_stamp[id] != _epoch) {
+      _stamp[id] = _epoch;
+      _state[id] = NOT_VISITED;
+      _dist[id] = Node<T>::INFINITY;
+      _prev[id] = -1;
+    }
+  }
+
+public:
+  QueryContext(size_t n = 0) : _stamp(), _state(), _dist(), _prev(), _order(), _epoch(1) {
+    resize(n);
+  }
+
+  // Returns number of nodes the context can hold
+  inline size_t size() const { return _stamp.size(); }
+
+  // Grows the context to hold n nodes, keeping the current query's entries
+  void resize(size_t n);
+
+  // Starts a new query on a graph of n nodes, invalidating all entries
+  void reset(size_t n);
+
+  inline STATUS state(int id) const {
+    return (_stamp[id] == _epoch) ? _state[id] : NOT_VISITED;
+  }
+  inline void setState(int id, STATUS s) { touch(id); _state[id] = s; }
+
+  inline T distance(int id) const {
+    return (_stamp[id] == _epoch) ? _dist[id] : Node<T>::INFINITY;
+  }
+  inline void setDistance(int id, T d) { touch(id); _dist[id] = d; }
+
+  inline int parent(int id) const {
+    return (_stamp[id] == _epoch) ? _prev[id] : -1;
+  }
+  inline void setParent(int id, int p) { touch(id); _prev[id] = p; }
+
+  inline std::vector<int> & order() { return _order; }
+  inline const std::vector<int> & order() const { return _order; }
+
+  // Returns the node IDs from the query's source to dest, or an empty path
+  // if dest was not reached
+  std::vector<int> path(int dest) const;
+};
+
+template<typename T>
+inline void QueryContext<T>::resize(size_t n) {
+  if (n > _stamp.size()) {
+    _stamp.resize(n, 0);
+    _state.resize(n, NOT_VISITED);
+    _dist.resize(n, Node<T>::INFINITY);
+    _prev.resize(n, -1);
+  }
+}
+
+template<typename T>
+inline void QueryContext<T>::reset(size_t n) {
+  resize(n);
+  _order.clear();
+
+  if (++_epoch == 0) { // stamps wrapped around, so old entries could look current
+    std::fill(_stamp.begin(), _stamp.end(), 0);
+    _epoch = 1;
+  }
+}
+
+template<typename T>
+std::vector<int> QueryContext<T>::path(int dest) const {
+  std::vector<int> nodes;
+  if (parent(dest) == -1) { return nodes; } // unreachable
+
+  nodes.push_back(dest);
+  while (parent(nodes.back()) != nodes.back()) { // source is its own parent
+    nodes.push_back(parent(nodes.back()));
+  }
+
+  std::reverse(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+#endif // _QUERYCONTEXT_HH_
@@ -0,0 +1,189 @@
+#ifndef _SNAPSHOT_HH_
+#define _SNAPSHOT_HH_
+
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+#include "MappedFile.hh"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Graph snapshots are stored little-endian and mapped as is"
+#endif
+
+/*
+ * Fixed 64-byte header of a graph snapshot file. The header is followed
+ * by the compressed-sparse-row arrays of the graph, each starting on an
+ * 8-byte boundary and zero-padded to one:
+ *   offsets      uint64[nNodes + 1]
+ *   targets      int32[nEdges]
+ *   weights      weight[nEdges]
+ *   node weights weight[nNodes]   (only with NODE_WEIGHTS)
+ * All values are little-endian, and the checksum covers every byte after
+ * the header.
+ */
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t weightSize; // bytes per weight
+  uint32_t weightKind; // one of Snapshot::UNSIGNED, SIGNED, REAL
+  uint64_t nNodes;
+  uint64_t nEdges; // both directions of an undirected edge
+  uint64_t checksum;
+  uint64_t reserved[2]; // zero
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "Snapshot header must be 64 bytes");
+static_assert(sizeof(size_t) == sizeof(uint64_t), "Snapshot offsets are mapped as size_t");
+
+/*
+ * Reads and writes graph snapshots
+ */
+class Snapshot {
+
+public:
+  static const uint32_t VERSION = 1;
+
+  // Header flags
+  static const uint32_t DIRECTED = 1;
+  static const uint32_t NODE_WEIGHTS = 2;
+
+  // Weight kinds
+  static const uint32_t UNSIGNED = 0;
+  static const uint32_t SIGNED = 1;
+  static const uint32_t REAL = 2;
+
+  // Returns the kind recorded for weights of type T
+  template<typename T>
+  static inline uint32_t kind() {
+    return std::is_floating_point<T>::value ? REAL : (std::is_signed<T>::value ? SIGNED : UNSIGNED);
+  }
+
+  // Rounds a section size up to a whole number of 8-byte words
+  static inline size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t) 7; }
+
+  // 64-bit FNV-1a over 8-byte words; len must be a multiple of 8
+  static inline uint64_t checksum(const char *data, size_t len, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < len; i += 8) {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      hash = (hash ^ word) * 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  /*
+   * Writes a snapshot from compressed-sparse-row arrays. nodeWeights may be null.
+   */
+  template<typename T>
+  static void write(const std::string &path, bool directed, size_t nNodes, size_t nEdges,
+		    const size_t *offsets, const int *targets, const T *weights, const T *nodeWeights);
+
+  /*
+   * Checks the header of a mapped snapshot against weight type T and the
+   * file size, and the checksum when verify is set. Throws
+   * std::runtime_error on mismatch.
+   */
+  template<typename T>
+  static const SnapshotHeader & validate(const MappedFile &file, bool verify);
+
+  // Size of a section of count items, padded. Throws std::runtime_error when
+  // the section would take more than an eighth of the address space, so the
+  // sum of the sections cannot overflow either.
+  static inline size_t bytes(uint64_t count, size_t size) {
+    if (size != 0 && count > std::numeric_limits<size_t>::max() / 8 / size) {
+      throw std::runtime_error("Snapshot is too large");
+    }
+    return padded(count * size);
+  }
+
+  // Locations of the arrays in a snapshot, in bytes from the start of the file
+  struct Layout {
+    size_t offsets, targets, weights, nodeWeights, end;
+
+    Layout(const SnapshotHeader &h)
+      : offsets(sizeof(SnapshotHeader)),
+	targets(offsets + bytes(h.nNodes, sizeof(uint64_t)) + sizeof(uint64_t)),
+	weights(targets + bytes(h.nEdges, sizeof(int32_t))),
+	nodeWeights(weights + bytes(h.nEdges, h.weightSize)),
+	end(nodeWeights + ((h.flags & NODE_WEIGHTS) ? bytes(h.nNodes, h.weightSize) : 0)) {}
+  };
+
+  // Writes a section followed by zero padding, folding it into the checksum
+  static inline void section(std::ofstream &out, const void *data, size_t bytes, uint64_t &hash) {
+    static const char zeros[8] = { 0 };
+    char tail[8] = { 0 };
+
+    size_t whole = bytes & ~(size_t) 7;
+    out.write(static_cast<const char *>(data), bytes);
+    hash = checksum(static_cast<const char *>(data), whole, hash);
+
+    if (whole != bytes) { // last partial word, zero-padded
+      memcpy(tail, static_cast<const char *>(data) + whole, bytes - whole);
+      out.write(zeros, 8 - (bytes - whole));
+      hash = checksum(tail, 8, hash);
+    }
+  }
+};
+
+template<typename T>
+void Snapshot::write(const std::string &path, bool directed, size_t nNodes, size_t nEdges,
+		     const size_t *offsets, const int *targets, const T *weights, const T *nodeWeights) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out.good()) { throw std::runtime_error("Couldn't open file " + path); }
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "GRAPHCSR", 8);
+  header.version = VERSION;
+  header.flags = (directed ? DIRECTED : 0) | (nodeWeights != nullptr ? NODE_WEIGHTS : 0);
+  header.weightSize = sizeof(T);
+  header.weightKind = kind<T>();
+  header.nNodes = nNodes;
+  header.nEdges = nEdges;
+
+  // Header is rewritten with the checksum once the arrays are out
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  uint64_t hash = checksum(nullptr, 0);
+  section(out, offsets, (nNodes + 1) * sizeof(size_t), hash);
+  section(out, targets, nEdges * sizeof(int), hash);
+  section(out, weights, nEdges * sizeof(T), hash);
+  if (nodeWeights != nullptr) { section(out, nodeWeights, nNodes * sizeof(T), hash); }
+
+  header.checksum = hash;
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  if (!out.good()) { throw std::runtime_error("Couldn't write file " + path); }
+}
+
+template<typename T>
+const SnapshotHeader & Snapshot::validate(const MappedFile &file, bool verify) {
+  if (file.size() < sizeof(SnapshotHeader) || memcmp(file.data(), "GRAPHCSR", 8) != 0) {
+    throw std::runtime_error("Not a graph snapshot");
+  }
+
+  const SnapshotHeader &header = *reinterpret_cast<const SnapshotHeader *>(file.data());
+  if (header.version != VERSION) {
+    throw std::runtime_error("Unsupported snapshot version - " + std::to_string(header.version));
+  }
+  if (header.weightSize != sizeof(T) || header.weightKind != kind<T>()) {
+    throw std::runtime_error("Snapshot weight type does not match the graph");
+  }
+  if (Layout(header).end != file.size()) {
+    throw std::runtime_error("Snapshot is truncated");
+  }
+  if (verify && checksum(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader))
+      != header.checksum) {
+    throw std::runtime_error("Snapshot checksum mismatch");
+  }
+  return header;
+}
+
+#endif // _SNAPSHOT_HH_
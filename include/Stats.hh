@@ -0,0 +1,101 @@
+#ifndef _STATS_HH_
+#define _STATS_HH_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Work done by the last instrumented algorithm that ran on a thread: nodes
+ * settled, edges scanned, distances improved, heap traffic, the number of
+ * nodes discovered on every BFS level, and the time spent resetting state,
+ * in the main loop and checking for cycles.
+ *
+ * Counting is compiled in only with -D GRAPH_STATS (make STATS=1); without
+ * it the GRAPH_* macros below expand to nothing and every counter stays
+ * zero. Each instrumented algorithm clears the calling thread's stats when
+ * it starts, so Stats::local() describes the last call. Work done by pool
+ * threads inside a parallel kernel is not counted, only its phases.
+ */
+struct Stats {
+  uint64_t settled; // nodes taken off the queue or stack for good
+  uint64_t scanned; // edges looked at
+  uint64_t relaxed; // edges that improved a distance
+  uint64_t pushes; // heap insertions
+  uint64_t pops; // heap removals
+  uint64_t decreases; // heap keys lowered in place
+  std::vector<uint64_t> frontier; // nodes discovered on every BFS level
+
+  double resetTime; // seconds spent clearing and initializing state
+  double mainTime; // seconds spent in the main loop
+  double checkTime; // seconds spent checking for (negative) cycles
+
+  Stats() : settled(0), scanned(0), relaxed(0), pushes(0), pops(0), decreases(0), frontier(),
+	    resetTime(0), mainTime(0), checkTime(0) {}
+
+  // Returns the stats of the calling thread
+  static inline Stats & local() {
+    static thread_local Stats stats;
+    return stats;
+  }
+
+  inline void clear() { *this = Stats(); }
+
+  // Counts one more node discovered on a BFS level
+  inline void discovered(size_t level) {
+    if (level >= frontier.size()) { frontier.resize(level + 1, 0); }
+    frontier[level]++;
+  }
+
+  // Returns the stats as a JSON object
+  std::string json() const {
+    std::ostringstream out;
+    out << "{\"settled\": " << settled << ", \"scanned\": " << scanned << ", \"relaxed\": " << relaxed
+	<< ", \"pushes\": " << pushes << ", \"pops\": " << pops << ", \"decreases\": " << decreases
+	<< ", \"frontier\": [";
+    for (size_t i = 0; i < frontier.size(); i++) { out << (i ? ", " : "") << frontier[i]; }
+    out << "], \"reset_sec\": " << resetTime << ", \"main_sec\": " << mainTime
+	<< ", \"check_sec\": " << checkTime << "}";
+    return out.str();
+  }
+};
+
+/*
+ * Adds the time from construction to destruction to a phase of the stats
+ */
+class PhaseTimer {
+
+private:
+  double &_phase;
+  std::chrono::steady_clock::time_point _start;
+
+  PhaseTimer() = delete; // Removes default constructor
+
+public:
+  explicit PhaseTimer(double &phase) : _phase(phase), _start(std::chrono::steady_clock::now()) {}
+
+  PhaseTimer(const PhaseTimer &other) = delete;
+  PhaseTimer & operator=(const PhaseTimer &other) = delete;
+
+  ~PhaseTimer() {
+    _phase += std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  }
+};
+
+#ifdef GRAPH_STATS
+#define GRAPH_STATS_START() Stats::local().clear()
+#define GRAPH_COUNT(counter) (Stats::local().counter++)
+#define GRAPH_COUNT_N(counter, n) (Stats::local().counter += (n))
+#define GRAPH_FRONTIER(level) Stats::local().discovered(level)
+#define GRAPH_PHASE(phase) PhaseTimer phase##Timer(Stats::local().phase##Time)
+#else
+#define GRAPH_STATS_START() ((void) 0)
+#define GRAPH_COUNT(counter) ((void) 0)
+#define GRAPH_COUNT_N(counter, n) ((void) 0)
+#define GRAPH_FRONTIER(level) ((void) 0)
+#define GRAPH_PHASE(phase) ((void) 0)
+#endif
+
+#endif // _STATS_HH_
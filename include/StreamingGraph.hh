@@ -0,0 +1,394 @@
+#ifndef _STREAMINGGRAPH_HH_
+#define _STREAMINGGRAPH_HH_
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+#include <limits>
+#include <cstddef>
+
+#include "Node.hh"
+#include "Edge.hh"
+#include "ThreadPool.hh"
+
+/*
+ * Single edge insertion or deletion in a batch of updates. A deletion
+ * removes every edge from start to end.
+ */
+template <typename T>
+struct EdgeUpdate {
+  int from;
+  int to;
+  T weight; // ignored by deletions
+  bool insert;
+
+  EdgeUpdate(int f, int t, T w, bool ins) : from(f), to(t), weight(w), insert(ins) {}
+
+  static inline EdgeUpdate insertion(int f, int t, T w) { return EdgeUpdate(f, t, w, true); }
+  static inline EdgeUpdate deletion(int f, int t) { return EdgeUpdate(f, t, (T) 0, false); }
+};
+
+/*
+ * Describes a graph that takes edge updates in batches while readers keep
+ * querying it. Every batch produces a new immutable View that shares all
+ * untouched adjacency lists with the previous one (copy-on-write per
+ * node), so a reader that holds a View sees one consistent graph for as
+ * long as it keeps it, and never waits for writers.
+ */
+template <typename T>
+class StreamingGraph {
+
+public:
+  // Outgoing edge stored in an adjacency list
+  struct Target {
+    int id;
+    T weight;
+  };
+
+  typedef std::vector<Target> Adjacency;
+
+  class View;
+
+private:
+  static const size_t PAGE_SIZE = 256; // adjacency lists per page
+
+  // Pages of adjacency lists, copied only when one of their lists changes
+  typedef std::vector<std::shared_ptr<const Adjacency> > Page;
+
+  std::shared_ptr<const View> _current; // latest version, swapped atomically
+  std::mutex _writer; // serializes batches
+
+  ThreadPool _pool;
+
+  bool _isDirected;
+
+  // Edge update in adjacency order: by start node, then by position in the batch
+  struct Op {
+    int from;
+    int to;
+    T weight;
+    bool insert;
+    size_t order;
+
+    Op(int f, int t, T w, bool ins, size_t o) : from(f), to(t), weight(w), insert(ins), order(o) {}
+    inline bool operator<(const Op &other) const {
+      return (from != other.from) ? from < other.from : order < other.order;
+    }
+  };
+
+  // Returns the new adjacency list of a node after the ops in [first, last)
+  static std::shared_ptr<const Adjacency> merge(const Adjacency *old, const Op *first, const Op *last);
+
+  StreamingGraph() = delete; // Removes default constructor
+
+public:
+  /*
+   * Immutable version of the graph, with the same interface as the other
+   * representations. Nodes only carry traversal state and are shared by
+   * all views, so concurrent readers should use the QueryContext versions
+   * of the algorithms.
+   */
+  class View {
+
+    friend class StreamingGraph<T>;
+
+  private:
+    std::vector<std::shared_ptr<const Page> > _pages;
+    std::shared_ptr<std::vector<Node<T> > > _nodes; // may hold more nodes than the view
+
+    size_t _nNodes;
+    size_t _nEdges;
+    bool _isDirected;
+
+    inline const Adjacency * list(int id) const {
+      const std::shared_ptr<const Adjacency> &adj = (*_pages[id / PAGE_SIZE])[id % PAGE_SIZE];
+      return adj.get();
+    }
+
+  public:
+    /*
+     * Iterates over the outgoing edges of a single node, yielding EdgeRef views
+     */
+    class EdgeIterator {
+
+    private:
+      Node<T> *_start;
+      Node<T> *_nodes;
+      const Target *_target;
+
+      mutable EdgeRef<T> _edge; // view handed out by dereferencing
+
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef EdgeRef<T> value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const EdgeRef<T> * pointer;
+      typedef const EdgeRef<T> & reference;
+
+      EdgeIterator(Node<T> *start, Node<T> *nodes, const Target *target)
+	: _start(start), _nodes(nodes), _target(target), _edge() {}
+      EdgeIterator(const EdgeIterator &other) = default;
+      EdgeIterator & operator=(const EdgeIterator &other) = default;
+
+      inline reference operator*() const {
+	_edge = EdgeRef<T>(_start, _nodes + _target->id, _target->weight);
+	return _edge;
+      }
+      inline pointer operator->() const { return &(operator*()); }
+
+      inline EdgeIterator & operator++() { ++_target; return *this; }
+      inline EdgeIterator operator++(int) { EdgeIterator tmp(*this); ++(*this); return tmp; }
+
+      inline bool operator==(const EdgeIterator &other) const { return _target == other._target; }
+      inline bool operator!=(const EdgeIterator &other) const { return _target != other._target; }
+    };
+
+    /*
+     * Outgoing edges of a node, returned by adjacent()
+     */
+    class EdgeRange {
+
+    private:
+      EdgeIterator _begin;
+      EdgeIterator _end;
+
+    public:
+      EdgeRange(const EdgeIterator &b, const EdgeIterator &e) : _begin(b), _end(e) {}
+
+      inline EdgeIterator begin() const { return _begin; }
+      inline EdgeIterator end() const { return _end; }
+    };
+
+    View(bool directed) : _pages(), _nodes(), _nNodes(0), _nEdges(0), _isDirected(directed) {}
+
+    // Returns number of nodes
+    inline size_t size() const { return _nNodes; }
+
+    // Returns number of stored edges (both directions of an undirected edge)
+    inline size_t numEdges() const { return _nEdges; }
+
+    // Returns node with the specified ID
+    inline Node<T> * node(int id) const { return &(*_nodes)[id]; }
+
+    // Returns whether the graph is directed
+    inline bool isDirected() const { return _isDirected; }
+
+    // Computes number of incoming and outgoing edges
+    size_t inDegree(const Node<T> *n) const;
+    inline size_t outDegree(const Node<T> *n) const {
+      const Adjacency *adj = list(n->getID());
+      return (adj == nullptr) ? 0 : adj->size();
+    }
+
+    // Returns range over all outgoing edges from a node
+    EdgeRange adjacent(const Node<T> *n) const;
+
+    // Sets all nodes as not visited with weight INFINITY
+    void reset();
+
+    // Prints the graph in the same format as AdjacencyList
+    friend std::ostream & operator<<(std::ostream &os, const View &g) {
+      for (size_t i = 0; i < g.size(); i++) {
+	os << i << ":";
+	for (auto& edge : g.adjacent(g.node(i))) {
+	  os << "("
+	     << i << ", "
+	     << edge->getEnd()->getID() << ", "
+	     << edge->getWeight() << ")";
+	}
+	os << std::endl;
+      }
+      return os;
+    }
+  };
+
+  // Empty graph with nNodes nodes; batches run on the given number of threads
+  StreamingGraph(size_t nNodes, bool directed, unsigned threads = 1);
+
+  StreamingGraph(const StreamingGraph &other) = delete;
+  StreamingGraph & operator=(const StreamingGraph &other) = delete;
+
+  // Returns the latest version of the graph; it stays valid and unchanged while held
+  inline std::shared_ptr<const View> snapshot() const { return std::atomic_load(&_current); }
+
+  // Returns whether the graph is directed
+  inline bool isDirected() const { return _isDirected; }
+
+  /*
+   * Applies a batch of updates, in batch order, and publishes the result as
+   * a new version. The batch need not be sorted. Each touched adjacency
+   * list is rebuilt once, and touched nodes are split across threads.
+   * New node IDs extend the graph.
+   */
+  void apply(const std::vector<EdgeUpdate<T> > &batch);
+};
+
+template<typename T>
+const size_t StreamingGraph<T>::PAGE_SIZE;
+
+template<typename T>
+StreamingGraph<T>::StreamingGraph(size_t nNodes, bool directed, unsigned threads)
+  : _current(), _writer(), _pool(threads), _isDirected(directed) {
+
+  std::shared_ptr<View> view = std::make_shared<View>(directed);
+  view->_nNodes = nNodes;
+  view->_nodes = std::make_shared<std::vector<Node<T> > >();
+  view->_nodes->reserve(nNodes);
+  for (size_t i = 0; i < nNodes; i++) { view->_nodes->push_back(Node<T>(i)); }
+
+  std::shared_ptr<const Page> empty = std::make_shared<const Page>(PAGE_SIZE);
+  view->_pages.assign((nNodes + PAGE_SIZE - 1) / PAGE_SIZE, empty);
+
+  _current = view;
+}
+
+template<typename T>
+std::shared_ptr<const typename StreamingGraph<T>::Adjacency>
+StreamingGraph<T>::merge(const Adjacency *old, const Op *first, const Op *last) {
+  // Latest deletion of every deleted target
+  std::vector<std::pair<int, size_t> > deleted;
+  for (const Op *op = first; op != last; ++op) {
+    if (!op->insert) { deleted.push_back(std::make_pair(op->to, op->order)); }
+  }
+  std::sort(deleted.begin(), deleted.end());
+
+  // Returns the batch position of the last deletion of target, if any
+  auto lastDeletion = [&](int target, size_t &order) {
+    auto it = std::upper_bound(deleted.begin(), deleted.end(),
+			       std::make_pair(target, std::numeric_limits<size_t>::max()));
+    if (it == deleted.begin() || (--it)->first != target) { return false; }
+    order = it->second;
+    return true;
+  };
+
+  std::shared_ptr<Adjacency> adj = std::make_shared<Adjacency>();
+  adj->reserve((old ? old->size() : 0) + (last - first));
+
+  size_t order;
+  if (old != nullptr) {
+    for (const Target &t : *old) {
+      if (deleted.empty() || !lastDeletion(t.id, order)) { adj->push_back(t); }
+    }
+  }
+  for (const Op *op = first; op != last; ++op) {
+    if (op->insert && (!lastDeletion(op->to, order) || order < op->order)) {
+      adj->push_back(Target{ op->to, op->weight });
+    }
+  }
+  return adj;
+}
+
+template<typename T>
+void StreamingGraph<T>::apply(const std::vector<EdgeUpdate<T> > &batch) {
+  std::lock_guard<std::mutex> lock(_writer);
+  std::shared_ptr<const View> old = std::atomic_load(&_current);
+
+  // Splits every update into its directed halves, grouped by start node
+  std::vector<Op> ops;
+  ops.reserve(_isDirected ? batch.size() : 2 * batch.size());
+  int maxID = -1;
+  for (size_t i = 0; i < batch.size(); i++) {
+    const EdgeUpdate<T> &u = batch[i];
+    if (u.from < 0 || u.to < 0) {
+      throw std::invalid_argument("Invalid Node ID - " + std::to_string(std::min(u.from, u.to)));
+    }
+    ops.push_back(Op(u.from, u.to, u.weight, u.insert, i));
+    if (!_isDirected) { ops.push_back(Op(u.to, u.from, u.weight, u.insert, i)); }
+    maxID = std::max(maxID, std::max(u.from, u.to));
+  }
+  std::sort(ops.begin(), ops.end());
+
+  std::vector<size_t> starts; // ops of the i-th touched node are [starts[i], starts[i + 1])
+  for (size_t i = 0; i < ops.size(); i++) {
+    if (i == 0 || ops[i].from != ops[i - 1].from) { starts.push_back(i); }
+  }
+  starts.push_back(ops.size());
+  const size_t touched = starts.size() - 1;
+
+  std::shared_ptr<View> view = std::make_shared<View>(_isDirected);
+  view->_nNodes = std::max(old->_nNodes, (size_t) (maxID + 1));
+  view->_nEdges = old->_nEdges;
+  view->_pages = old->_pages;
+  view->_nodes = old->_nodes;
+
+  // Nodes are shared by all views, so new nodes go into a larger copy
+  if (view->_nNodes > view->_nodes->size()) {
+    size_t capacity = std::max(view->_nNodes, 2 * view->_nodes->size());
+    std::shared_ptr<std::vector<Node<T> > > nodes = std::make_shared<std::vector<Node<T> > >();
+    nodes->reserve(capacity);
+    for (size_t i = 0; i < capacity; i++) { nodes->push_back(Node<T>(i)); }
+    view->_nodes = nodes;
+  }
+  view->_pages.resize((view->_nNodes + PAGE_SIZE - 1) / PAGE_SIZE, std::make_shared<const Page>(PAGE_SIZE));
+
+  // Copies every page with a touched list, once
+  std::vector<std::shared_ptr<Page> > copies(view->_pages.size());
+  std::vector<Page *> pages(touched);
+  for (size_t i = 0; i < touched; i++) {
+    size_t p = ops[starts[i]].from / PAGE_SIZE;
+    if (!copies[p]) { copies[p] = std::make_shared<Page>(*view->_pages[p]); }
+    pages[i] = copies[p].get();
+  }
+
+  // Rebuilds the touched lists in parallel, each in one pass
+  std::vector<long long> delta(_pool.size(), 0);
+  _pool.parallelFor(0, touched, [&](size_t b, size_t e, unsigned id) {
+      for (size_t i = b; i < e; i++) {
+	int from = ops[starts[i]].from;
+	std::shared_ptr<const Adjacency> &slot = (*pages[i])[from % PAGE_SIZE];
+	long long before = slot ? slot->size() : 0;
+	slot = merge(slot.get(), ops.data() + starts[i], ops.data() + starts[i + 1]);
+	delta[id] += (long long) slot->size() - before;
+      }
+    }, 64);
+
+  for (auto d : delta) { view->_nEdges += d; }
+  for (size_t p = 0; p < copies.size(); p++) {
+    if (copies[p]) { view->_pages[p] = copies[p]; }
+  }
+
+  std::atomic_store(&_current, std::shared_ptr<const View>(view));
+}
+
+template<typename T>
+inline size_t StreamingGraph<T>::View::inDegree(const Node<T> *n) const {
+  size_t deg = 0;
+  for (size_t i = 0; i < _nNodes; i++) {
+    const Adjacency *adj = list(i);
+    if (adj == nullptr) { continue; }
+    for (const Target &t : *adj) {
+      if (t.id == n->getID()) { deg++; }
+    }
+  }
+  return deg;
+}
+
+template<typename T>
+inline typename StreamingGraph<T>::View::EdgeRange StreamingGraph<T>::View::adjacent(const Node<T> *n) const {
+  if (n->getID() < 0 || (size_t)n->getID() >= _nNodes) {
+    throw std::invalid_argument("Invalid Node ID - " + std::to_string(n->getID()) ); // if node doesn't exist
+  }
+
+  const Adjacency *adj = list(n->getID());
+  const Target *first = (adj == nullptr) ? nullptr : adj->data();
+  const Target *last = (adj == nullptr) ? nullptr : adj->data() + adj->size();
+  Node<T> *start = node(n->getID());
+  return EdgeRange(EdgeIterator(start, _nodes->data(), first),
+		   EdgeIterator(start, _nodes->data(), last));
+}
+
+template<typename T>
+inline void StreamingGraph<T>::View::reset() {
+  for (size_t i = 0; i < _nNodes; i++) {
+    (*_nodes)[i].setState(NOT_VISITED);
+    (*_nodes)[i].setWeight(Node<T>::INFINITY);
+  }
+}
+
+#endif // _STREAMINGGRAPH_HH_
@@ -0,0 +1,137 @@
+#ifndef _THREADPOOL_HH_
+#define _THREADPOOL_HH_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+/*
+ * Fixed set of worker threads that run one job at a time, fork-join style.
+ * run() hands the job to every worker and to the calling thread, and returns
+ * once all of them are done. Workers are started once, so algorithms with
+ * many short phases (e.g. one per BFS level) do not pay for thread creation.
+ */
+class ThreadPool {
+
+private:
+  std::vector<std::thread> _workers;
+
+  std::function<void(unsigned)> _job; // takes the ID of the thread running it
+  std::exception_ptr _error; // first exception thrown by the current job
+
+  std::mutex _mutex;
+  std::condition_variable _start;
+  std::condition_variable _done;
+
+  size_t _generation; // incremented for every job
+  unsigned _pending; // workers still running the current job
+  bool _stop;
+
+  // Runs the job, keeping the first exception to rethrow in the caller
+  inline void execute(unsigned id) {
+    try {
+      _job(id);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_error) { _error = std::current_exception(); }
+    }
+  }
+
+  inline void work(unsigned id) {
+    size_t seen = 0;
+    while (true) {
+      {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_start.wait(lock, [&]{ return _stop || _generation != seen; });
+	if (_stop) { return; }
+	seen = _generation;
+      }
+
+      execute(id);
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (--_pending == 0) { _done.notify_one(); }
+    }
+  }
+
+public:
+  // Returns the number of hardware threads, at least 1
+  static inline unsigned hardwareThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return (n == 0) ? 1 : n;
+  }
+
+  explicit ThreadPool(unsigned threads = hardwareThreads())
+    : _workers(), _job(), _error(), _mutex(), _start(), _done(),
+      _generation(0), _pending(0), _stop(false) {
+    for (unsigned i = 1; i < threads; i++) { // calling thread acts as thread 0
+      _workers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+  }
+
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool & operator=(const ThreadPool &other) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _start.notify_all();
+    for (auto& t : _workers) { t.join(); }
+  }
+
+  // Returns number of threads, including the calling thread
+  inline unsigned size() const { return _workers.size() + 1; }
+
+  // Runs job(threadID) on every thread and waits for all of them
+  inline void run(const std::function<void(unsigned)> &job) {
+    if (_workers.empty()) {
+      job(0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _job = job;
+      _error = nullptr;
+      _pending = _workers.size();
+      _generation++;
+    }
+    _start.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&]{ return _pending == 0; });
+    if (_error) { std::rethrow_exception(_error); }
+  }
+
+  // Splits [first, last) into chunks of grain indices that threads claim
+  // dynamically, calling fn(begin, end, threadID) for each chunk. Small
+  // ranges run on the calling thread alone.
+  template<class Function>
+  void parallelFor(size_t first, size_t last, Function fn, size_t grain = 1024) {
+    if (last <= first) { return; }
+    if (_workers.empty() || last - first <= grain) {
+      fn(first, last, 0);
+      return;
+    }
+
+    std::atomic<size_t> next(first);
+    run([&](unsigned id) {
+	size_t begin;
+	while ((begin = next.fetch_add(grain)) < last) {
+	  fn(begin, std::min(begin + grain, last), id);
+	}
+      });
+  }
+};
+
+#endif // _THREADPOOL_HH_
@@ -0,0 +1,86 @@
+#ifndef _UNIONFIND_HH_
+#define _UNIONFIND_HH_
+
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+/*
+ * Disjoint sets of node IDs that many threads can merge at once without
+ * locks. Every entry packs the rank (upper 32 bits) and parent (lower 32
+ * bits) of a node into one atomic word, so linking a root below another
+ * and raising a rank are single compare-and-swap operations. A failed one
+ * means another thread changed the root first, and the union is retried.
+ * Lower-ranked roots go below higher-ranked ones, ties broken by ID, and
+ * find() halves the path it walks.
+ */
+class UnionFind {
+
+private:
+  std::vector<std::atomic<uint64_t> > _entries;
+
+  static inline uint64_t pack(uint32_t rank, int parent) {
+    return ((uint64_t) rank << 32) | (uint32_t) parent;
+  }
+  static inline int parentOf(uint64_t entry) { return (int) (uint32_t) entry; }
+  static inline uint32_t rankOf(uint64_t entry) { return (uint32_t) (entry >> 32); }
+
+  UnionFind() = delete;
+
+public:
+  // Puts every ID below n in a set of its own
+  explicit UnionFind(size_t n) : _entries(n) {
+    for (size_t i = 0; i < n; i++) { _entries[i].store(pack(0, i), std::memory_order_relaxed); }
+  }
+
+  inline size_t size() const { return _entries.size(); }
+
+  // Returns the root of the set holding id
+  inline int find(int id) {
+    while (true) {
+      uint64_t entry = _entries[id].load(std::memory_order_relaxed);
+      int parent = parentOf(entry);
+      if (parent == id) { return id; }
+
+      int grandparent = parentOf(_entries[parent].load(std::memory_order_relaxed));
+      if (grandparent != parent) { // skips the parent; losing the race only skips less
+	_entries[id].compare_exchange_weak(entry, pack(rankOf(entry), grandparent),
+					   std::memory_order_relaxed);
+      }
+      id = grandparent;
+    }
+  }
+
+  // Merges the sets holding a and b, returning false if they were one set already
+  inline bool unite(int a, int b) {
+    while (true) {
+      a = find(a);
+      b = find(b);
+      if (a == b) { return false; }
+
+      uint64_t entryA = _entries[a].load(std::memory_order_relaxed);
+      uint64_t entryB = _entries[b].load(std::memory_order_relaxed);
+      if (parentOf(entryA) != a || parentOf(entryB) != b) { continue; } // no longer roots
+
+      if (rankOf(entryA) > rankOf(entryB) || (rankOf(entryA) == rankOf(entryB) && a > b)) {
+	std::swap(a, b);
+	std::swap(entryA, entryB);
+      }
+      if (!_entries[a].compare_exchange_strong(entryA, pack(rankOf(entryA), b),
+					       std::memory_order_acq_rel)) {
+	continue;
+      }
+      if (rankOf(entryA) == rankOf(entryB)) { // fails harmlessly if b stopped being a root
+	_entries[b].compare_exchange_strong(entryB, pack(rankOf(entryB) + 1, b),
+					    std::memory_order_acq_rel);
+      }
+      return true;
+    }
+  }
+
+  // Returns whether a and b are in the same set
+  inline bool same(int a, int b) { return find(a) == find(b); }
+};
+
+#endif // _UNIONFIND_HH_
@@ -0,0 +1,208 @@
+#include "../include/AdjacencyList.hh"
+#include "../include/AdjacencyMatrix.hh"
+#include "../include/CSRGraph.hh"
+#include "../include/ThreadPool.hh"
+#include "../include/UnionFind.hh"
+#include "../include/Stats.hh"
+#include "../include/DepthFirstForest.hh"
+
+#include <unordered_map>
+#include <cstdint>
+
+namespace graph {
+
+  /*
+   * Component of every node, numbered 0, 1, ... densely, and the number of
+   * nodes in each component. Missing nodes have component -1.
+   */
+  struct Components {
+    std::vector<int> component;
+    std::vector<size_t> sizes;
+
+    Components() : component(), sizes() {}
+
+    inline size_t count() const { return sizes.size(); }
+  };
+
+  /*
+   * Numbers the sets of a union-find densely, in order of their first node
+   */
+  template <class Graph_T>
+  void labelComponents(const Graph_T &g, const std::vector<int> &roots, Components &c) {
+    const size_t n = g.size();
+    std::vector<int> label(n, -1); // component of every root
+
+    c.component.assign(n, -1);
+    c.sizes.clear();
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) == nullptr) { continue; }
+      int &l = label[roots[i]];
+      if (l == -1) {
+	l = c.sizes.size();
+	c.sizes.push_back(0);
+      }
+      c.component[i] = l;
+      c.sizes[l]++;
+    }
+  }
+
+  /*
+   * Returns the next number of a splitmix64 generator, which is plenty for
+   * sampling nodes. Unlike <random>, it does not bring in the INFINITY macro
+   * of <cmath>, which would break Node<T>::INFINITY in later includes.
+   */
+  inline uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  /*
+   * Finds the connected components of an undirected graph, or the weakly
+   * connected components of a directed one, by merging the ends of every
+   * edge in a union-find
+   */
+  template <class Graph_T>
+  void ConnectedComponents(const Graph_T &g, Components &c) {
+    const size_t n = g.size();
+    UnionFind sets(n);
+
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) == nullptr) { continue; }
+      for (auto& edge : g.adjacent(g.node(i))) {
+	sets.unite(i, edge->getEnd()->getID());
+      }
+    }
+
+    std::vector<int> roots(n);
+    for (size_t i = 0; i < n; i++) { roots[i] = sets.find(i); }
+    labelComponents(g, roots, c);
+  }
+
+  /*
+   * Finds the connected components in parallel with Afforest (Sutton et
+   * al.) on a lock-free union-find. The first two edges of every node are
+   * merged first, which in most graphs already joins the bulk of the nodes
+   * into one giant component. A random sample of nodes identifies that
+   * component, and only the nodes outside it merge their remaining edges.
+   *
+   * A directed graph offers no incoming edges to skip the giant component
+   * by, so there every node merges all of its edges.
+   */
+  template <class Graph_T>
+  void ParallelConnectedComponents(const Graph_T &g, Components &c, ThreadPool &pool) {
+    const size_t n = g.size(), rounds = 2, samples = 1024;
+    UnionFind sets(n);
+
+    // Merges the edges of every node from position first on, up to last
+    auto link = [&](size_t first, size_t last, int skip) {
+      pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	  for (size_t i = b; i < e; i++) {
+	    if (g.node(i) == nullptr || (skip != -1 && sets.find(i) == skip)) { continue; }
+	    size_t k = 0;
+	    for (auto& edge : g.adjacent(g.node(i))) {
+	      if (k >= last) { break; }
+	      if (k++ >= first) { sets.unite(i, edge->getEnd()->getID()); }
+	    }
+	  }
+	}, 256);
+    };
+
+    for (size_t r = 0; r < rounds; r++) { link(r, r + 1, -1); }
+
+    // The most frequent root in the sample is most likely the giant component
+    int giant = -1;
+    if (!g.isDirected() && n > 0) {
+      uint64_t random = 12345;
+      std::unordered_map<int, size_t> counts;
+      size_t best = 0;
+      for (size_t s = 0; s < samples; s++) {
+	size_t id = splitmix64(random) % n;
+	if (g.node(id) == nullptr) { continue; }
+	size_t count = ++counts[sets.find(id)];
+	if (count > best) {
+	  best = count;
+	  giant = sets.find(id);
+	}
+      }
+    }
+
+    link(rounds, (size_t) -1, giant);
+
+    std::vector<int> roots(n);
+    pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) { roots[i] = sets.find(i); }
+      }, 4096);
+    labelComponents(g, roots, c);
+  }
+
+  template <class Graph_T>
+  void ParallelConnectedComponents(const Graph_T &g, Components &c,
+				   unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    ParallelConnectedComponents(g, c, pool);
+  }
+
+  /*
+   * Finds the strongly connected components with Tarjan's algorithm, as a
+   * visitor of the depth-first search engine, so long paths cannot
+   * overflow the call stack. low[id] is the earliest discovery time that
+   * the subtree of id reaches through an edge into a component not
+   * completed yet. Components are numbered in the order Tarjan's algorithm
+   * completes them, which is a reverse topological order of the condensed
+   * graph.
+   */
+  template <class Graph_T>
+  void StronglyConnectedComponents(const Graph_T &g, Components &c) {
+    // Keeps the nodes of components not completed yet, and pops a component at its root
+    struct Tarjan : DFSVisitor {
+      const DFSTree &tree;
+      Components &c;
+      std::vector<int> low, nodes;
+      std::vector<bool> onStack;
+      Tarjan(const DFSTree &t, Components &comps, size_t n)
+	: tree(t), c(comps), low(n, -1), nodes(), onStack(n, false) {}
+
+      inline void discoverVertex(int id) {
+	low[id] = tree.discovery[id];
+	nodes.push_back(id);
+	onStack[id] = true;
+      }
+      inline void backEdge(int from, int to) { low[from] = std::min(low[from], tree.discovery[to]); }
+      inline void forwardOrCrossEdge(int from, int to) {
+	if (onStack[to]) { low[from] = std::min(low[from], tree.discovery[to]); }
+      }
+      inline void finishVertex(int id) {
+	int p = tree.parent[id];
+	if (p != id) { low[p] = std::min(low[p], low[id]); }
+	if (low[id] != tree.discovery[id]) { return; }
+
+	int label = c.sizes.size(); // id is the root of a component
+	c.sizes.push_back(0);
+	int member;
+	do {
+	  member = nodes.back();
+	  nodes.pop_back();
+	  onStack[member] = false;
+	  c.component[member] = label;
+	  c.sizes[label]++;
+	} while (member != id);
+      }
+    };
+
+    const size_t n = g.size();
+    GRAPH_STATS_START();
+    DFSTree tree;
+    {
+      GRAPH_PHASE(reset);
+      c.component.assign(n, -1);
+      c.sizes.clear();
+      tree.reset(n);
+    }
+    GRAPH_PHASE(main);
+
+    Tarjan tarjan(tree, c, n);
+    DepthFirstForest(g, 0, n, tree, tarjan);
+  }
+}
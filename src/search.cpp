@@ -1,85 +1,475 @@
 #include "../include/AdjacencyList.hh"
 #include "../include/AdjacencyMatrix.hh"
+#include "../include/CSRGraph.hh"
+#include "../include/QueryContext.hh"
+#include "../include/ThreadPool.hh"
+#include "../include/AtomicBitmap.hh"
+#include "../include/Stats.hh"
+#include "../include/DepthFirstForest.hh"
+
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+
+// Forward declaration of helper methods
+inline void printOrder(const std::vector<int> &order);
 
 namespace graph {
 
   /*
-   * Preforms recursive depth-first search starting from a specified node
+   * Preforms depth-first search from a specified node
+   */
+  template <class Graph_T, class Visitor>
+  void DepthFirstSearch(const Graph_T &g, int src, DFSTree &tree, Visitor &visitor) {
+    requireNode(g, src);
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      tree.reset(g.size());
+    }
+    GRAPH_PHASE(main);
+    DepthFirstForest(g, src, src + 1, tree, visitor);
+  }
+
+  /*
+   * Preforms depth-first search from every node in order of ID, so that
+   * every node is reached
+   */
+  template <class Graph_T, class Visitor>
+  void DepthFirstSearch(const Graph_T &g, DFSTree &tree, Visitor &visitor) {
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      tree.reset(g.size());
+    }
+    GRAPH_PHASE(main);
+    DepthFirstForest(g, 0, g.size(), tree, visitor);
+  }
+
+  /*
+   * Preforms depth-first search starting from a specified node, recording
+   * the results in the query context
    */
   template <typename T, class Graph_T>
-  void DFS(Graph_T &g, Node<T> *src) {
-    g.reset();
-    
-    src->setState(VISITED);
-    
-    for (auto& edge : g.adjacent(src)) {
-      if (edge->getEnd()->getState() == NOT_VISITED) {
-	  DFS(g, edge->getEnd());
+  void DFS(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    requireNode(g, src);
+
+    // Records the visit order in the context
+    struct Recorder : DFSVisitor {
+      QueryContext<T> &ctx;
+      explicit Recorder(QueryContext<T> &c) : ctx(c) {}
+      inline void discoverVertex(int id) {
+	ctx.setState(id, VISITED);
+	ctx.order().push_back(id);
       }
+    };
+
+    GRAPH_STATS_START();
+    DFSTree tree;
+    {
+      GRAPH_PHASE(reset);
+      ctx.reset(g.size());
+      tree.reset(g.size());
     }
+    GRAPH_PHASE(main);
+
+    Recorder recorder(ctx);
+    DepthFirstForest(g, src, src + 1, tree, recorder);
+    for (int id : ctx.order()) { ctx.setParent(id, tree.parent[id]); }
   }
-  
+
+  template <typename T, class Graph_T>
+  void DFS(const Graph_T &g, Node<T> *src, bool print = false) {
+    QueryContext<T> ctx(g.size());
+    DFS(g, src->getID(), ctx);
+
+    if (print) { printOrder(ctx.order()); }
+  }
+
   /*
-   * Preforms non-recursive depth-first search starting from specified node
+   * Same as DFS, which no longer recurses
    */
   template <typename T, class Graph_T>
-  void DFS_iterative(Graph_T &g, Node<T> *src, bool print = false) {
-    g.reset();
-    
-    std::stack<Node<T>* > nodeStack;
-    std::vector<int> order; // allows you to print the order of traversal
-    
-    nodeStack.push(src);
-    
-    while (!nodeStack.empty()) {
-      auto top = nodeStack.top();
-      nodeStack.pop();
-      
-      if (top->getState() == NOT_VISITED) {
-	top->setState(VISITED);
-	order.push_back(top->getID());
+  void DFS_iterative(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    DFS(g, src, ctx);
+  }
+
+  template <typename T, class Graph_T>
+  void DFS_iterative(const Graph_T &g, Node<T> *src, bool print = false) {
+    DFS(g, src, print);
+  }
+
+  /*
+   * Returns the nodes of a cycle in the order of its edges, or an empty
+   * vector if the graph has none. A cycle closes with the first back edge
+   * the search meets; in an undirected graph the edge back to the parent
+   * does not count.
+   */
+  template <class Graph_T>
+  std::vector<int> FindCycle(const Graph_T &g) {
+    // Remembers the first back edge that closes a cycle
+    struct CycleFinder : DFSVisitor {
+      const Graph_T &g;
+      const DFSTree &tree;
+      int from, to;
+      CycleFinder(const Graph_T &graph, const DFSTree &t) : g(graph), tree(t), from(-1), to(-1) {}
+      inline void backEdge(int u, int v) {
+	if (from != -1 || (!g.isDirected() && v == tree.parent[u] && u != v)) { return; }
+	from = u;
+	to = v;
       }
-      
-      for (auto& edge : g.adjacent(top)) {
-	nodeStack.push(edge->getEnd());
+    };
+
+    DFSTree tree;
+    CycleFinder finder(g, tree);
+    DepthFirstSearch(g, tree, finder);
+
+    std::vector<int> cycle;
+    if (finder.from == -1) { return cycle; }
+    for (int id = finder.from; id != finder.to; id = tree.parent[id]) { cycle.push_back(id); }
+    cycle.push_back(finder.to);
+
+    std::reverse(cycle.begin(), cycle.end()); // parents run against the edges
+    return cycle;
+  }
+
+  /*
+   * Returns the nodes of an undirected graph whose removal disconnects
+   * their component, in increasing order of ID. low[id] is the earliest
+   * discovery time reachable from the subtree of id through one back edge;
+   * a parent is an articulation point when a child's subtree cannot reach
+   * above it, and a root when it has more than one child.
+   */
+  template <class Graph_T>
+  std::vector<int> ArticulationPoints(const Graph_T &g) {
+    if (g.isDirected()) { throw std::invalid_argument("Graph must be undirected."); }
+
+    // Propagates low values up the tree as nodes finish
+    struct LowLink : DFSVisitor {
+      const DFSTree &tree;
+      std::vector<int> low, children;
+      std::vector<bool> cut;
+      LowLink(const DFSTree &t, size_t n) : tree(t), low(n, -1), children(n, 0), cut(n, false) {}
+      inline void discoverVertex(int id) { low[id] = tree.discovery[id]; }
+      inline void treeEdge(int from, int) { children[from]++; }
+      inline void backEdge(int from, int to) {
+	if (to != tree.parent[from]) { low[from] = std::min(low[from], tree.discovery[to]); }
       }
-    }
+      inline void finishVertex(int id) {
+	int p = tree.parent[id];
+	if (p == id) {
+	  cut[id] = (children[id] > 1);
+	  return;
+	}
+	low[p] = std::min(low[p], low[id]);
+	if (tree.parent[p] != p && low[id] >= tree.discovery[p]) { cut[p] = true; }
+      }
+    };
+
+    DFSTree tree;
+    LowLink lowLink(tree, g.size());
+    DepthFirstSearch(g, tree, lowLink);
 
-    if (print) {
-      copy(order.begin(), order.end()-1, std::ostream_iterator<int>(std::cout, ", "));
-      std::cout << order.back(); // prints last element without the delimiter
+    std::vector<int> points;
+    for (size_t i = 0; i < g.size(); i++) {
+      if (lowLink.cut[i]) { points.push_back(i); }
     }
+    return points;
   }
-  
+
   /*
-   * Preforms breadth-first search on a specified start node
+   * Preforms breadth-first search on a specified start node, recording the
+   * hop distance and parent of every reached node in the query context
    */
   template<typename T, class Graph_T>
-  void BFS(Graph_T &g, Node<T> *src, bool print = false) {
-    g.reset();
-  
-    std::queue<Node<T>* > nodeQueue;
-    std::vector<int> order;
-    
+  void BFS(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    requireNode(g, src);
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      ctx.reset(g.size());
+    }
+    GRAPH_PHASE(main);
+
+    std::queue<int> nodeQueue;
+
     nodeQueue.push(src);
-    
+    ctx.setState(src, PENDING);
+    ctx.setDistance(src, (T) 0);
+    ctx.setParent(src, src);
+    GRAPH_FRONTIER(0);
+
     while (!nodeQueue.empty()) {
-      auto front = nodeQueue.front();
+      int front = nodeQueue.front();
       nodeQueue.pop();
-      
-      front->setState(VISITED);
-      order.push_back(front->getID());
-      for (auto& edge : g.adjacent(front)) {
-	if (edge->getEnd()->getState() == NOT_VISITED) {
-	  edge->getEnd()->setState(PENDING);
-	  nodeQueue.push(edge->getEnd());
+
+      ctx.setState(front, VISITED);
+      ctx.order().push_back(front);
+      GRAPH_COUNT(settled);
+      for (auto& edge : g.adjacent(g.node(front))) {
+	int next = edge->getEnd()->getID();
+	GRAPH_COUNT(scanned);
+	if (ctx.state(next) == NOT_VISITED) {
+	  ctx.setState(next, PENDING);
+	  ctx.setDistance(next, ctx.distance(front) + (T) 1);
+	  ctx.setParent(next, front);
+	  nodeQueue.push(next);
+	  GRAPH_FRONTIER((size_t) ctx.distance(next));
 	}
       }
     }
-    
-    if (print) {
-      copy(order.begin(), order.end()-1, std::ostream_iterator<int>(std::cout, ", "));
-      std::cout << order.back(); // prints last element without the delimiter
+  }
+
+  template<typename T, class Graph_T>
+  void BFS(const Graph_T &g, Node<T> *src, bool print = false) {
+    QueryContext<T> ctx(g.size());
+    BFS(g, src->getID(), ctx);
+
+    if (print) { printOrder(ctx.order()); }
+  }
+
+  /*
+   * Depth and parent of every node after a parallel breadth-first search,
+   * -1 for nodes that were not reached
+   */
+  struct BFSTree {
+    std::vector<int> depth;
+    std::vector<int> parent;
+
+    BFSTree() : depth(), parent() {}
+  };
+
+  /*
+   * Preforms level-synchronous parallel breadth-first search that switches
+   * between top-down steps (expand the frontier) and bottom-up steps (every
+   * unvisited node looks for a parent in the frontier), whichever scans
+   * fewer edges. Bottom-up steps need the incoming edges of a node: reverse
+   * must list them through adjacent(), or be null to stay top-down.
+   */
+  template<class Graph_T, class Reverse_T>
+  void ParallelBFS(const Graph_T &g, const Reverse_T *reverse, int src, BFSTree &tree,
+		   ThreadPool &pool) {
+    requireNode(g, src);
+    const size_t n = g.size();
+    const size_t alpha = 15, beta = 18; // switching thresholds from Beamer et al.
+
+    tree.depth.assign(n, -1);
+    tree.parent.assign(n, -1);
+
+    AtomicBitmap visited(n), front(n), next(n);
+    std::vector<std::vector<int> > found(pool.size()); // nodes discovered by each thread
+    std::vector<size_t> scouts(pool.size()); // outgoing edges of those nodes
+    std::vector<size_t> counts(pool.size());
+
+    std::vector<int> frontier(1, src);
+    visited.set(src);
+    tree.depth[src] = 0;
+    tree.parent[src] = src;
+
+    // Edges leaving the frontier, and edges leaving still unvisited nodes
+    size_t scout = g.outDegree(g.node(src)), unexplored = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) != nullptr) { unexplored += g.outDegree(g.node(i)); }
+    }
+
+    bool topDown = true;
+    size_t awake = 1; // size of the frontier
+    for (int level = 0; awake > 0; level++) {
+      unexplored -= std::min(scout, unexplored);
+
+      if (topDown && reverse != nullptr && scout > unexplored / alpha) {
+	// Switch to bottom-up: turn the frontier queue into a bitmap
+	front.clear();
+	pool.parallelFor(0, frontier.size(), [&](size_t b, size_t e, unsigned) {
+	    for (size_t i = b; i < e; i++) { front.set(frontier[i]); }
+	  });
+	topDown = false;
+      }
+      else if (!topDown && awake < n / beta) {
+	// Switch to top-down: collect the frontier bitmap into a queue
+	for (auto& f : found) { f.clear(); }
+	pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned id) {
+	    for (size_t v = b; v < e; v++) {
+	      if (front.get(v)) { found[id].push_back(v); }
+	    }
+	  }, 4096);
+	frontier.clear();
+	for (auto& f : found) { frontier.insert(frontier.end(), f.begin(), f.end()); }
+	topDown = true;
+      }
+
+      for (auto& f : found) { f.clear(); }
+      std::fill(scouts.begin(), scouts.end(), 0);
+      std::fill(counts.begin(), counts.end(), 0);
+
+      if (topDown) {
+	pool.parallelFor(0, frontier.size(), [&](size_t b, size_t e, unsigned id) {
+	    size_t edges = 0; // summed locally to keep threads off each other's cache lines
+	    for (size_t i = b; i < e; i++) {
+	      int u = frontier[i];
+	      for (auto& edge : g.adjacent(g.node(u))) {
+		int v = edge->getEnd()->getID();
+		if (!visited.get(v) && visited.set(v)) { // this thread claimed v
+		  tree.parent[v] = u;
+		  tree.depth[v] = level + 1;
+		  found[id].push_back(v);
+		  edges += g.outDegree(g.node(v));
+		}
+	      }
+	    }
+	    scouts[id] += edges;
+	  }, 64);
+
+	frontier.clear();
+	for (auto& f : found) { frontier.insert(frontier.end(), f.begin(), f.end()); }
+	awake = frontier.size();
+      }
+      else {
+	next.clear();
+	pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned id) {
+	    size_t nodes = 0, edges = 0;
+	    for (size_t v = b; v < e; v++) {
+	      if (visited.get(v) || reverse->node(v) == nullptr) { continue; }
+	      for (auto& edge : reverse->adjacent(reverse->node(v))) {
+		int u = edge->getEnd()->getID();
+		if (front.get(u)) { // adopt the first parent found in the frontier
+		  tree.parent[v] = u;
+		  tree.depth[v] = level + 1;
+		  visited.set(v);
+		  next.set(v);
+		  nodes++;
+		  edges += g.outDegree(g.node(v));
+		  break;
+		}
+	      }
+	    }
+	    counts[id] += nodes;
+	    scouts[id] += edges;
+	  }, 1024);
+
+	std::swap(front, next);
+	awake = 0;
+	for (auto c : counts) { awake += c; }
+      }
+
+      scout = 0;
+      for (auto s : scouts) { scout += s; }
+    }
+  }
+
+  // Undirected graphs serve as their own reverse; directed ones stay top-down
+  template<class Graph_T>
+  void ParallelBFS(const Graph_T &g, int src, BFSTree &tree, ThreadPool &pool) {
+    ParallelBFS(g, g.isDirected() ? nullptr : &g, src, tree, pool);
+  }
+
+  template<class Graph_T>
+  void ParallelBFS(const Graph_T &g, int src, BFSTree &tree,
+		   unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    ParallelBFS(g, src, tree, pool);
+  }
+
+  /*
+   * Preforms breadth-first search from many sources in one sweep per level.
+   * Sources are taken in batches of 64 * Words; every node carries one bit
+   * per source of the batch for the sources that have seen it and for
+   * those whose frontier it is on, so each edge of a frontier node is
+   * scanned once for the whole batch. visit(i, id, depth) is called once
+   * for every node that sources[i] reaches, including the source itself at
+   * depth 0, in order of depth within a batch.
+   */
+  template<unsigned Words = 4, class Graph_T, class Visitor>
+  void MultiSourceBFS(const Graph_T &g, const std::vector<int> &sources, Visitor visit) {
+    static_assert(Words > 0, "Batches need at least one word of sources");
+    const size_t n = g.size(), batch = 64 * Words;
+
+    std::vector<uint64_t> seen(n * Words), frontier(n * Words), next(n * Words);
+    std::vector<int> active, reached; // nodes with a non-empty frontier / next mask
+
+    // Calls visit for every source whose bit is set in mask
+    auto report = [&](size_t first, const uint64_t *mask, int id, int depth) {
+      for (unsigned w = 0; w < Words; w++) {
+	for (uint64_t bits = mask[w]; bits != 0; bits &= bits - 1) {
+	  visit(first + 64 * w + __builtin_ctzll(bits), id, depth);
+	}
+      }
+    };
+
+    for (size_t first = 0; first < sources.size(); first += batch) {
+      size_t last = std::min(sources.size(), first + batch);
+      std::fill(seen.begin(), seen.end(), 0);
+
+      active.clear();
+      for (size_t i = first; i < last; i++) {
+	int src = sources[i];
+	uint64_t *mask = &frontier[(size_t) src * Words];
+	if (std::all_of(mask, mask + Words, [](uint64_t word) { return word == 0; })) {
+	  active.push_back(src); // first source of the batch at this node
+	}
+	uint64_t bit = (uint64_t) 1 << ((i - first) & 63);
+	seen[(size_t) src * Words + (i - first) / 64] |= bit;
+	mask[(i - first) / 64] |= bit;
+      }
+      for (int id : active) { report(first, &frontier[(size_t) id * Words], id, 0); }
+
+      for (int depth = 1; !active.empty(); depth++) {
+	// Pushes every frontier mask along the node's edges
+	reached.clear();
+	for (int id : active) {
+	  uint64_t *mask = &frontier[(size_t) id * Words];
+	  for (auto& edge : g.adjacent(g.node(id))) {
+	    uint64_t *target = &next[(size_t) edge->getEnd()->getID() * Words];
+	    bool empty = true;
+	    for (unsigned w = 0; w < Words; w++) {
+	      empty = empty && target[w] == 0;
+	      target[w] |= mask[w];
+	    }
+	    if (empty) { reached.push_back(edge->getEnd()->getID()); }
+	  }
+	  std::fill(mask, mask + Words, 0);
+	}
+
+	// Keeps only the sources that reach a node for the first time
+	active.clear();
+	for (int id : reached) {
+	  uint64_t *mask = &next[(size_t) id * Words], *known = &seen[(size_t) id * Words];
+	  uint64_t *fresh = &frontier[(size_t) id * Words];
+	  uint64_t any = 0;
+	  for (unsigned w = 0; w < Words; w++) {
+	    fresh[w] = mask[w] & ~known[w];
+	    known[w] |= fresh[w];
+	    any |= fresh[w];
+	    mask[w] = 0;
+	  }
+	  if (any != 0) {
+	    active.push_back(id);
+	    report(first, fresh, id, depth);
+	  }
+	}
+      }
     }
   }
+
+  /*
+   * Preforms breadth-first search from many sources in batches, recording
+   * in depth[i][id] the hop distance from sources[i] to every node, -1 for
+   * nodes that were not reached
+   */
+  template<class Graph_T>
+  void MultiSourceBFS(const Graph_T &g, const std::vector<int> &sources,
+		      std::vector<std::vector<int> > &depth) {
+    depth.assign(sources.size(), std::vector<int>(g.size(), -1));
+    MultiSourceBFS(g, sources, [&](size_t i, int id, int d) { depth[i][id] = d; });
+  }
+}
+
+/*
+ * Prints the node ID's in the order of traversal, separated by commas
+ */
+inline void printOrder(const std::vector<int> &order) {
+  if (order.empty()) { return; }
+
+  copy(order.begin(), order.end()-1, std::ostream_iterator<int>(std::cout, ", "));
+  std::cout << order.back(); // prints last element without the delimiter
 }
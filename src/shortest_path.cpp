@@ -1,169 +1,926 @@
 #include "../include/AdjacencyList.hh"
 #include "../include/AdjacencyMatrix.hh"
+#include "../include/CSRGraph.hh"
+#include "../include/QueryContext.hh"
+#include "../include/IndexedHeap.hh"
+#include "../include/BucketQueue.hh"
+#include "../include/ThreadPool.hh"
+#include "../include/MinPlus.hh"
+#include "../include/Stats.hh"
 
+#include <iterator>
+#include <sstream>
+#include <mutex>
 
-// Forward declaration of helper methods
-template<typename T>
-void printPath (Node<T> *src, Node<T> *dest, const std::vector<Node<T>* > &prev);
 
-template<typename T>
-inline bool operator<(const Node<T> *a, const Node<T> *b) {
-  return (a->getWeight() < b->getWeight());
-}
+// Forward declaration of helper methods
+inline void printPath(const std::vector<int> &path);
 
 namespace graph {
-  
+
   /*
-   * Finds the shortest path between two nodes, given that all edge weights
-   * are positive
+   * Finds the shortest path from a source to every node, given that all edge
+   * weights are positive. Distances and predecessors go into the query context.
+   * The queue must be addressable (IndexedHeap or BucketQueue) and can be
+   * reused across queries.
    */
+  template<typename T, class Graph_T, class Queue_T>
+  void Dijkstra(const Graph_T &g, int src, QueryContext<T> &ctx, Queue_T &minDist) {
+    requireNode(g, src);
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      ctx.reset(g.size());
+      minDist.clear();
+      minDist.resize(g.size());
+    }
+    GRAPH_PHASE(main);
+
+    ctx.setDistance(src, (T) 0); // sets starting point with weight 0
+    ctx.setParent(src, src);
+    minDist.push(src, (T) 0); // adds starting point to the heap
+    GRAPH_COUNT(pushes);
+
+    while (!minDist.empty()) {
+      int top = minDist.pop();
+      ctx.setState(top, VISITED);
+      GRAPH_COUNT(pops);
+      GRAPH_COUNT(settled);
+
+      for (auto& edge : g.adjacent(g.node(top))) {
+	GRAPH_COUNT(scanned);
+	if (edge->getWeight() < 0) { // throw exception if edge weights are positive
+	  throw std::runtime_error("Error: Negative Edge Weight - " +
+				   std::to_string(edge->getWeight()));
+	}
+	int neighbor = edge->getEnd()->getID();
+	T dist = ctx.distance(top) + edge->getWeight();
+	if (dist < ctx.distance(neighbor)) {
+	  ctx.setDistance(neighbor, dist);
+	  ctx.setParent(neighbor, top);
+	  GRAPH_COUNT(relaxed);
+	  if (minDist.contains(neighbor)) {
+	    minDist.decrease(neighbor, dist);
+	    GRAPH_COUNT(decreases);
+	  }
+	  else {
+	    minDist.push(neighbor, dist);
+	    GRAPH_COUNT(pushes);
+	  }
+	}
+      }
+    }
+  }
+
   template<typename T, class Graph_T>
-  T Dijkstra(Graph_T &g, Node<T> *src, Node<T> *dest, bool print = false) {
-    g.reset(); // Sets all nodes to unvisited and weight INFINITY
-    
-    std::priority_queue<Node<T>* > minDist;
-    std::vector<Node<T>* > prevNode(g.size(), nullptr); // allows you to print order of traversal
-    
-    src->setWeight((T) 0); // sets starting point with weight 0
-    minDist.push(src); // adds starting point to the heap
-    prevNode[src->getID()] = src;
-    
+  void Dijkstra(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    IndexedHeap<T> minDist(g.size());
+    Dijkstra(g, src, ctx, minDist);
+  }
+
+  /*
+   * Shortest path between two nodes: its length, INFINITY if the destination
+   * is not reachable, and its node IDs from source to destination, empty if
+   * it is not reachable
+   */
+  template<typename T>
+  struct Path {
+    T distance;
+    std::vector<int> nodes;
+
+    Path() : distance(Node<T>::INFINITY), nodes() {}
+  };
+
+  /*
+   * Finds the shortest path between two nodes, given that all edge weights
+   * are positive. The search stops as soon as dest is settled, so only the
+   * nodes closer to src than dest are scanned.
+   */
+  template<typename T, class Graph_T, class Queue_T>
+  Path<T> Dijkstra(const Graph_T &g, int src, int dest, QueryContext<T> &ctx, Queue_T &minDist) {
+    requireNode(g, src);
+    requireNode(g, dest);
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      ctx.reset(g.size());
+      minDist.clear();
+      minDist.resize(g.size());
+    }
+    GRAPH_PHASE(main);
+
+    ctx.setDistance(src, (T) 0);
+    ctx.setParent(src, src);
+    minDist.push(src, (T) 0);
+    GRAPH_COUNT(pushes);
+
     while (!minDist.empty()) {
-      auto top = minDist.top();
-      minDist.pop();
-      if (top->getState() == NOT_VISITED) {
-	
-	top->setState(VISITED);
-	
-	for (auto& edge : g.adjacent(top)) {
-	  if (edge->getWeight() < 0) { // throw exception if edge weights are positive
-	    throw std::runtime_error("Error: Negative Edge Weight - " + 
-				     std::to_string(edge->getWeight()));
+      int top = minDist.pop();
+      ctx.setState(top, VISITED);
+      GRAPH_COUNT(pops);
+      GRAPH_COUNT(settled);
+      if (top == dest) { break; }
+
+      for (auto& edge : g.adjacent(g.node(top))) {
+	GRAPH_COUNT(scanned);
+	if (edge->getWeight() < 0) {
+	  throw std::runtime_error("Error: Negative Edge Weight - " +
+				   std::to_string(edge->getWeight()));
+	}
+	int neighbor = edge->getEnd()->getID();
+	T dist = ctx.distance(top) + edge->getWeight();
+	if (dist < ctx.distance(neighbor)) {
+	  ctx.setDistance(neighbor, dist);
+	  ctx.setParent(neighbor, top);
+	  GRAPH_COUNT(relaxed);
+	  if (minDist.contains(neighbor)) {
+	    minDist.decrease(neighbor, dist);
+	    GRAPH_COUNT(decreases);
 	  }
-	  Node<T> *neighbor = edge->getEnd();
-	  if (neighbor->getWeight() >= top->getWeight() + edge->getWeight()){
-	    neighbor->setWeight(top->getWeight() + edge->getWeight());
-	    prevNode[neighbor->getID()] = top;
+	  else {
+	    minDist.push(neighbor, dist);
+	    GRAPH_COUNT(pushes);
 	  }
-	  minDist.push(neighbor);
 	}
       }
     }
-    
+
+    Path<T> path;
+    path.distance = ctx.distance(dest);
+    path.nodes = ctx.path(dest);
+    return path;
+  }
+
+  template<typename T, class Graph_T>
+  Path<T> Dijkstra(const Graph_T &g, int src, int dest, QueryContext<T> &ctx) {
+    IndexedHeap<T> minDist(g.size());
+    return Dijkstra(g, src, dest, ctx, minDist);
+  }
+
+  /*
+   * Finds the shortest path between two nodes, given that all edge weights
+   * are positive
+   */
+  template<typename T, class Graph_T>
+  T Dijkstra(const Graph_T &g, Node<T> *src, Node<T> *dest, bool print = false) {
+    QueryContext<T> ctx(g.size());
+    Path<T> path = Dijkstra(g, src->getID(), dest->getID(), ctx);
+
     if (print) { // prints shortest path
-      printPath(src, dest, prevNode);
+      printPath(path.nodes);
       std::cout << " => ";
     }
-    
-  return dest->getWeight();
+
+    return path.distance;
   }
-  
+
   /*
-   * Finds the shortest path between two nodes.
+   * Settles the closest unsettled node of one side of a bidirectional
+   * search, and records the best path through a node the other side reached
    */
   template<typename T, class Graph_T>
-  T BellmanFord(Graph_T &g, Node<T> *src, Node<T> *dest, bool print = false) {
-    g.reset(); // Sets all nodes to unvisited and weight INFINITY
-    
-    std::vector<Node<T>* > prevNode(g.size(), nullptr); // allows you to print order of traversal
-    
-    src->setWeight((T) 0);
-    prevNode[src->getID()] = src;
-    
-    for (size_t i = 0; i < g.size(); i++) {
-      for (auto& edge : g.adjacent(g.node(i))) {
-	if (edge->getStart()->getWeight() + edge->getWeight() <=
-	    edge->getEnd()->getWeight()) {
-	  
-	  edge->getEnd()->setWeight(edge->getStart()->getWeight() + edge->getWeight());
-	  prevNode[edge->getEnd()->getID()] = edge->getStart();
+  void BidirectionalStep(const Graph_T &g, QueryContext<T> &ctx, IndexedHeap<T> &queue,
+			 const QueryContext<T> &other, T &best, int &meet) {
+    int top = queue.pop();
+    ctx.setState(top, VISITED);
+
+    for (auto& edge : g.adjacent(g.node(top))) {
+      if (edge->getWeight() < 0) {
+	throw std::runtime_error("Error: Negative Edge Weight - " +
+				 std::to_string(edge->getWeight()));
+      }
+      int neighbor = edge->getEnd()->getID();
+      T dist = ctx.distance(top) + edge->getWeight();
+      if (dist < ctx.distance(neighbor)) {
+	ctx.setDistance(neighbor, dist);
+	ctx.setParent(neighbor, top);
+	if (queue.contains(neighbor)) { queue.decrease(neighbor, dist); }
+	else { queue.push(neighbor, dist); }
+      }
+      T through = other.distance(neighbor);
+      if (through != Node<T>::INFINITY && ctx.distance(neighbor) + through < best) {
+	best = ctx.distance(neighbor) + through;
+	meet = neighbor;
+      }
+    }
+  }
+
+  /*
+   * Finds the shortest path between two nodes with bidirectional Dijkstra,
+   * given that all edge weights are positive. One search runs forward from
+   * src over g and one backward from dest over reverse, which must list the
+   * incoming edges of a node through adjacent(). The search with the closer
+   * frontier advances next, and both stop once their frontiers together are
+   * at least as long as the best path through a node reached by both.
+   */
+  template<typename T, class Graph_T, class Reverse_T>
+  Path<T> BidirectionalDijkstra(const Graph_T &g, const Reverse_T &reverse, int src, int dest,
+				QueryContext<T> &forward, QueryContext<T> &backward) {
+    requireNode(g, src);
+    requireNode(g, dest);
+    forward.reset(g.size());
+    backward.reset(g.size());
+
+    IndexedHeap<T> forwardQueue(g.size()), backwardQueue(g.size());
+
+    forward.setDistance(src, (T) 0);
+    forward.setParent(src, src);
+    forwardQueue.push(src, (T) 0);
+    backward.setDistance(dest, (T) 0);
+    backward.setParent(dest, dest);
+    backwardQueue.push(dest, (T) 0);
+
+    T best = (src == dest) ? (T) 0 : Node<T>::INFINITY;
+    int meet = (src == dest) ? src : -1;
+
+    // Advances the side whose closest unsettled node is nearer
+    while (!forwardQueue.empty() && !backwardQueue.empty() &&
+	   forwardQueue.topKey() + backwardQueue.topKey() < best) {
+      if (forwardQueue.topKey() <= backwardQueue.topKey()) {
+	BidirectionalStep(g, forward, forwardQueue, backward, best, meet);
+      }
+      else {
+	BidirectionalStep(reverse, backward, backwardQueue, forward, best, meet);
+      }
+    }
+
+    Path<T> path;
+    if (meet == -1) { return path; } // unreachable
+
+    // Forward parents lead back to src, backward parents lead on to dest
+    path.distance = best;
+    path.nodes = forward.path(meet);
+    for (int id = meet; id != dest; ) {
+      id = backward.parent(id);
+      path.nodes.push_back(id);
+    }
+    return path;
+  }
+
+  /*
+   * Finds the shortest path between two nodes with bidirectional Dijkstra.
+   * Undirected graphs serve as their own reverse; directed ones are
+   * transposed first, so callers with many queries should keep a reverse
+   * graph and use the version above.
+   */
+  template<class Graph_T>
+  auto BidirectionalDijkstra(const Graph_T &g, int src, int dest) -> Path<decltype(g.node(0)->getWeight())> {
+    typedef decltype(g.node(0)->getWeight()) T;
+
+    QueryContext<T> forward(g.size()), backward(g.size());
+    if (!g.isDirected()) { return BidirectionalDijkstra(g, g, src, dest, forward, backward); }
+    return BidirectionalDijkstra(g, CSRGraph<T>(g).transpose(), src, dest, forward, backward);
+  }
+
+  /*
+   * Finds the shortest path between two nodes with A*, given that all edge
+   * weights are positive. Nodes are ordered by distance plus estimate(id),
+   * a lower bound on the distance from id to dest such as the straight-line
+   * distance. The estimate is a template parameter so that it inlines. A
+   * node that is reached again on a shorter path is scanned again, so the
+   * path is exact for any estimate that never overestimates, and no node is
+   * scanned twice if the estimate is also consistent.
+   */
+  template<typename T, class Graph_T, class Heuristic>
+  Path<T> AStar(const Graph_T &g, int src, int dest, Heuristic estimate,
+		QueryContext<T> &ctx, IndexedHeap<T> &open) {
+    requireNode(g, src);
+    requireNode(g, dest);
+    ctx.reset(g.size());
+
+    open.clear();
+    open.resize(g.size());
+
+    ctx.setDistance(src, (T) 0);
+    ctx.setParent(src, src);
+    open.push(src, estimate(src));
+
+    while (!open.empty()) {
+      int top = open.pop();
+      ctx.setState(top, VISITED);
+      if (top == dest) { break; }
+
+      for (auto& edge : g.adjacent(g.node(top))) {
+	if (edge->getWeight() < 0) {
+	  throw std::runtime_error("Error: Negative Edge Weight - " +
+				   std::to_string(edge->getWeight()));
+	}
+	int neighbor = edge->getEnd()->getID();
+	T dist = ctx.distance(top) + edge->getWeight();
+	if (dist < ctx.distance(neighbor)) {
+	  ctx.setDistance(neighbor, dist);
+	  ctx.setParent(neighbor, top);
+	  if (open.contains(neighbor)) { open.decrease(neighbor, dist + estimate(neighbor)); }
+	  else { open.push(neighbor, dist + estimate(neighbor)); }
 	}
       }
     }
-    
+
+    Path<T> path;
+    path.distance = ctx.distance(dest);
+    path.nodes = ctx.path(dest);
+    return path;
+  }
+
+  template<class Graph_T, class Heuristic>
+  auto AStar(const Graph_T &g, int src, int dest, Heuristic estimate) -> Path<decltype(g.node(0)->getWeight())> {
+    typedef decltype(g.node(0)->getWeight()) T;
+
+    QueryContext<T> ctx(g.size());
+    IndexedHeap<T> open(g.size());
+    return AStar(g, src, dest, estimate, ctx, open);
+  }
+
+  /*
+   * Distance and predecessor of every node after a single-source shortest
+   * path search, INFINITY and -1 for nodes that were not reached
+   */
+  template<typename T>
+  struct PathTree {
+    std::vector<T> distance;
+    std::vector<int> parent;
+
+    PathTree() : distance(), parent() {}
+  };
+
+  /*
+   * Finds the shortest path from a source to every node with parallel
+   * delta-stepping, given that all edge weights are positive. Nodes are kept
+   * in buckets of width delta; the nodes of the lowest bucket relax their
+   * light edges (weight <= delta) in parallel until the bucket stays empty,
+   * then relax their heavy edges once. Relaxation requests are routed to the
+   * thread that owns the target node, so distances are updated without locks.
+   *
+   * A ring holds the buckets of a window of at most |V| + 1 of them, so a
+   * small delta against heavy edges costs no more memory than the graph.
+   * Nodes in buckets past the window wait in an overflow list, and move
+   * into the ring when the window slides up to them.
+   */
+  template<typename T, class Graph_T>
+  void DeltaStepping(const Graph_T &g, int src, T delta, PathTree<T> &tree, ThreadPool &pool) {
+    requireNode(g, src);
+    if (!(delta > 0)) {
+      throw std::invalid_argument("Bucket width must be positive - " + std::to_string(delta));
+    }
+
+    const size_t n = g.size(), P = pool.size();
+
+    // Rejects negative weights before any work starts, and finds the largest weight
+    std::vector<T> maxWeights(P, (T) 0);
+    pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned id) {
+	for (size_t i = b; i < e; i++) {
+	  if (g.node(i) == nullptr) { continue; }
+	  for (auto& edge : g.adjacent(g.node(i))) {
+	    if (edge->getWeight() < 0) {
+	      throw std::runtime_error("Error: Negative Edge Weight - " +
+				       std::to_string(edge->getWeight()));
+	    }
+	    maxWeights[id] = std::max(maxWeights[id], edge->getWeight());
+	  }
+	}
+      });
+    T maxWeight = *std::max_element(maxWeights.begin(), maxWeights.end());
+
+    // Live buckets always lie within maxWeight / delta + 1 of the current one,
+    // so a ring of that many buckets never needs the overflow lists
+    const double span = (double) (maxWeight / delta) + 2;
+    const size_t nBuckets = (span < (double) (n + 1)) ? (size_t) span : n + 1;
+    auto bucketOf = [&](T d) { return (size_t) (d / delta); };
+    size_t base = 0; // first bucket of the window
+
+    struct Request {
+      int node;
+      int parent;
+      T dist;
+    };
+
+    std::vector<std::vector<std::vector<int> > > buckets(P, std::vector<std::vector<int> >(nBuckets));
+    std::vector<std::vector<int> > overflow(P);
+    std::vector<std::vector<std::vector<Request> > > requests(P, std::vector<std::vector<Request> >(P));
+
+    std::vector<T> &dist = tree.distance;
+    dist.assign(n, Node<T>::INFINITY);
+    tree.parent.assign(n, -1);
+
+    // Generates requests for the light or heavy edges of a set of nodes
+    auto relax = [&](const std::vector<int> &nodes, bool light) {
+      pool.parallelFor(0, nodes.size(), [&](size_t b, size_t e, unsigned id) {
+	  for (size_t i = b; i < e; i++) {
+	    int u = nodes[i];
+	    for (auto& edge : g.adjacent(g.node(u))) {
+	      if ((edge->getWeight() <= delta) != light) { continue; }
+
+	      int v = edge->getEnd()->getID();
+	      T d = dist[u] + edge->getWeight();
+	      if (d < dist[v]) {
+		Request r = { v, u, d };
+		requests[id][v % P].push_back(r);
+	      }
+	    }
+	  }
+	}, 256);
+
+      // Every thread applies the requests for the nodes it owns
+      pool.run([&](unsigned id) {
+	  for (size_t p = 0; p < P; p++) {
+	    for (auto& r : requests[p][id]) {
+	      if (r.dist < dist[r.node]) {
+		dist[r.node] = r.dist;
+		tree.parent[r.node] = r.parent;
+		size_t b = bucketOf(r.dist);
+		if (b < base + nBuckets) { buckets[id][b % nBuckets].push_back(r.node); }
+		else { overflow[id].push_back(r.node); }
+	      }
+	    }
+	    requests[p][id].clear();
+	  }
+	});
+    };
+
+    // Slides the window up to the nearest bucket in the overflow lists, from
+    // current on, and moves the nodes that fall into it to the ring. Returns
+    // false if no node is left.
+    auto slide = [&](size_t &current) {
+      size_t next = (size_t) -1;
+      for (auto& list : overflow) {
+	for (int v : list) {
+	  size_t b = bucketOf(dist[v]);
+	  if (b >= current) { next = std::min(next, b); }
+	}
+      }
+      if (next == (size_t) -1) { return false; }
+
+      base = current = next;
+      for (size_t p = 0; p < P; p++) {
+	size_t kept = 0;
+	for (int v : overflow[p]) {
+	  size_t b = bucketOf(dist[v]);
+	  if (b < current) { continue; } // settled in an earlier bucket since
+	  if (b < base + nBuckets) { buckets[p][b % nBuckets].push_back(v); }
+	  else { overflow[p][kept++] = v; }
+	}
+	overflow[p].resize(kept);
+      }
+      return true;
+    };
+
+    dist[src] = (T) 0;
+    tree.parent[src] = src;
+    buckets[0][0].push_back(src);
+
+    std::vector<int> frontier, settled;
+    std::vector<size_t> inFrontier(n, 0), inSettled(n, 0); // stamps of the last round / bucket
+    size_t round = 0;
+
+    for (size_t current = 0; ; current++) {
+      // Finds the next non-empty bucket, sliding the window once it runs out
+      bool empty = true;
+      while (empty) {
+	for (; current < base + nBuckets; current++) {
+	  for (size_t p = 0; p < P && empty; p++) {
+	    empty = buckets[p][current % nBuckets].empty();
+	  }
+	  if (!empty) { break; }
+	}
+	if (empty && !slide(current)) { break; }
+      }
+      if (empty) { break; } // all buckets are empty
+
+      settled.clear();
+      while (true) {
+	// Takes the nodes whose distance still falls into the current bucket
+	frontier.clear();
+	round++;
+	for (size_t p = 0; p < P; p++) {
+	  for (int v : buckets[p][current % nBuckets]) {
+	    if (bucketOf(dist[v]) == current && inFrontier[v] != round) {
+	      inFrontier[v] = round;
+	      frontier.push_back(v);
+	    }
+	  }
+	  buckets[p][current % nBuckets].clear();
+	}
+	if (frontier.empty()) { break; }
+
+	for (int v : frontier) {
+	  if (inSettled[v] != current + 1) {
+	    inSettled[v] = current + 1;
+	    settled.push_back(v);
+	  }
+	}
+
+	relax(frontier, true);
+      }
+
+      relax(settled, false);
+    }
+  }
+
+  template<typename T, class Graph_T>
+  void DeltaStepping(const Graph_T &g, int src, T delta, PathTree<T> &tree,
+		     unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    DeltaStepping(g, src, delta, tree, pool);
+  }
+
+  /*
+   * Finds the shortest path from a source to every node. Distances and
+   * predecessors go into the query context. Makes at most |V| - 1 passes
+   * over the edges, stopping early once a pass relaxes nothing.
+   */
+  template<typename T, class Graph_T>
+  void BellmanFord(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    requireNode(g, src);
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      ctx.reset(g.size());
+    }
+
+    ctx.setDistance(src, (T) 0);
+    ctx.setParent(src, src);
+
+    bool changed = true;
+    {
+      GRAPH_PHASE(main);
+      for (size_t pass = 1; pass < g.size() && changed; pass++) {
+	changed = false;
+	for (size_t i = 0; i < g.size(); i++) {
+	  if (g.node(i) == nullptr || ctx.distance(i) == Node<T>::INFINITY) { continue; } // not reached yet
+
+	  for (auto& edge : g.adjacent(g.node(i))) {
+	    int end = edge->getEnd()->getID();
+	    GRAPH_COUNT(scanned);
+	    if (ctx.distance(i) + edge->getWeight() < ctx.distance(end)) {
+	      ctx.setDistance(end, ctx.distance(i) + edge->getWeight());
+	      ctx.setParent(end, i);
+	      GRAPH_COUNT(relaxed);
+	      changed = true;
+	    }
+	  }
+	}
+      }
+    }
+
     // Checks for Negative Cycle
-    for (size_t i = 0; i < g.size(); i++) {
+    GRAPH_PHASE(check);
+    for (size_t i = 0; i < g.size() && changed; i++) {
+      if (g.node(i) == nullptr || ctx.distance(i) == Node<T>::INFINITY) { continue; }
+
       for (auto& edge : g.adjacent(g.node(i))) {
-	if (edge->getStart()->getWeight() + edge->getWeight() <
-	    edge->getEnd()->getWeight()) {
-	  
+	GRAPH_COUNT(scanned);
+	if (ctx.distance(i) + edge->getWeight() < ctx.distance(edge->getEnd()->getID())) {
 	   throw std::runtime_error("Graph contains negative-weight cycle");
 	}
       }
     }
+  }
+
+  /*
+   * Returns the cycle in the predecessor graph that id leads into, or an
+   * empty vector if following predecessors from id reaches a source
+   */
+  template<typename T>
+  std::vector<int> predecessorCycle(const QueryContext<T> &ctx, int id, size_t n) {
+    std::vector<int> cycle;
+
+    // After n steps without reaching a source, the walk must be on the cycle
+    for (size_t i = 0; i < n; i++) {
+      if (ctx.parent(id) == id) { return cycle; }
+      id = ctx.parent(id);
+    }
+
+    cycle.push_back(id);
+    for (int next = ctx.parent(id); next != id; next = ctx.parent(next)) {
+      cycle.push_back(next);
+    }
+
+    std::reverse(cycle.begin(), cycle.end()); // predecessors run against the edges
+    return cycle;
+  }
+
+  /*
+   * Finds the shortest path from a set of sources (all at distance 0) to every
+   * node with a queue-based Bellman-Ford: only nodes whose distance changed
+   * are scanned again, and the search ends as soon as none are left.
+   *
+   * Returns an empty vector on success. If a negative-weight cycle is
+   * reachable, returns its node IDs in edge order instead, and the
+   * predecessors in the query context are no longer a tree.
+   */
+  template<typename T, class Graph_T>
+  std::vector<int> BellmanFordQueue(const Graph_T &g, const std::vector<int> &sources,
+				    QueryContext<T> &ctx) {
+    for (int src : sources) { requireNode(g, src); }
+    const size_t n = g.size();
+    ctx.reset(n);
+
+    std::queue<int> worklist;
+    std::vector<size_t> length(n, 0); // edges on the current path to each node
+
+    for (int src : sources) {
+      ctx.setDistance(src, (T) 0);
+      ctx.setParent(src, src);
+      ctx.setState(src, PENDING); // PENDING marks nodes in the worklist
+      worklist.push(src);
+    }
+
+    while (!worklist.empty()) {
+      int top = worklist.front();
+      worklist.pop();
+      ctx.setState(top, VISITED);
+
+      for (auto& edge : g.adjacent(g.node(top))) {
+	int end = edge->getEnd()->getID();
+	T dist = ctx.distance(top) + edge->getWeight();
+	if (!(dist < ctx.distance(end))) { continue; }
+
+	ctx.setDistance(end, dist);
+	ctx.setParent(end, top);
+
+	// A path of n edges repeats a node, so the predecessors may contain a cycle
+	length[end] = length[top] + 1;
+	if (length[end] >= n) {
+	  std::vector<int> cycle = predecessorCycle(ctx, end, n);
+	  if (!cycle.empty()) { return cycle; }
+	}
+
+	if (ctx.state(end) != PENDING) {
+	  ctx.setState(end, PENDING);
+	  worklist.push(end);
+	}
+      }
+    }
+
+    return std::vector<int>();
+  }
+
+  template<typename T, class Graph_T>
+  std::vector<int> BellmanFordQueue(const Graph_T &g, int src, QueryContext<T> &ctx) {
+    return BellmanFordQueue(g, std::vector<int>(1, src), ctx);
+  }
+
+  /*
+   * Returns the node IDs of a negative-weight cycle anywhere in the graph, or
+   * an empty vector if there is none
+   */
+  template<class Graph_T>
+  auto NegativeCycle(const Graph_T &g) -> std::vector<int> {
+    typedef decltype(g.node(0)->getWeight()) T;
+
+    // Every node starts at distance 0, as if reached from a virtual source
+    std::vector<int> sources;
+    for (size_t i = 0; i < g.size(); i++) {
+      if (g.node(i) != nullptr) { sources.push_back(i); }
+    }
+
+    QueryContext<T> ctx(g.size());
+    return BellmanFordQueue(g, sources, ctx);
+  }
+
+  /*
+   * Finds the shortest path between two nodes.
+   */
+  template<typename T, class Graph_T>
+  T BellmanFord(const Graph_T &g, Node<T> *src, Node<T> *dest, bool print = false) {
+    QueryContext<T> ctx(g.size());
+    BellmanFord(g, src->getID(), ctx);
 
     if (print) {
-      printPath(src ,dest, prevNode);
+      printPath(ctx.path(dest->getID()));
       std::cout << " => ";
     }
-    
-    return dest->getWeight();
+
+    return ctx.distance(dest->getID());
   }
-  
-  
+
+
   /*
-   * Finds the all-pairs shortest path
+   * Finds the all-pairs shortest path into a row-major n x n matrix, where
+   * dist[i * n + j] is the distance from i to j, or INFINITY if there is no
+   * path. The matrix is split into block x block tiles; for every diagonal
+   * tile, the tile itself is solved first, then the tiles in its row and
+   * column, then all remaining tiles, each group in parallel.
    */
   template<typename T, class Graph_T>
-  void FloydWarshall(Graph_T &g, std::vector<std::vector<T> > &dist) {
-    g.reset();
-    
-    // Vector reference gets passed in from outside method
-    dist.resize(g.size(), std::vector<double>(g.size(), std::numeric_limits<T>::max()));
-    
-    for (size_t i = 0; i < g.size(); i++) {
-      dist[i][i] = 0; 
-      // Initialize distances for all edges
-      for (auto &edge : g.adjacent(g.node(i))) {
-	dist[i][edge->getEnd()->getID()] = edge->getWeight();
-      }
-    }
-    
-    for (size_t k = 0; k < g.size(); k++) { 
-      for (size_t i = 0; i < g.size(); i++) { 
-	for (size_t j = 0; j < g.size(); j++) { 
-	  if (dist[i][j] > dist[i][k] + dist[k][j]) {
-	    dist[i][j] =  dist[i][k] + dist[k][j];
-	  }
+  void FloydWarshall(const Graph_T &g, std::vector<T> &dist, ThreadPool &pool, size_t block = 64) {
+    const size_t n = g.size();
+    GRAPH_STATS_START();
+    {
+      GRAPH_PHASE(reset);
+      dist.assign(n * n, Node<T>::INFINITY);
+
+      for (size_t i = 0; i < n; i++) {
+	if (g.node(i) == nullptr) { continue; }
+	dist[i * n + i] = 0;
+	// Initialize distances for all edges
+	for (auto &edge : g.adjacent(g.node(i))) {
+	  T &d = dist[i * n + edge->getEnd()->getID()];
+	  d = std::min(d, edge->getWeight());
+	  GRAPH_COUNT(scanned);
 	}
       }
     }
 
-    // Checks for Negative Cycle
-    for (size_t i = 0; i < g.size(); i++) {
-      for (auto& edge : g.adjacent(g.node(i))) {
-	if (edge->getStart()->getWeight() + edge->getWeight() <
-	    edge->getEnd()->getWeight()) {
-	  
-	   throw std::runtime_error("Graph contains negative-weight cycle");
+    const size_t tiles = (n + block - 1) / block;
+    T *D = dist.data();
+
+    // Relaxes tile (ti, tj) through the nodes of tile tk
+    auto relax = [&](size_t ti, size_t tj, size_t tk) {
+      size_t iEnd = std::min(n, (ti + 1) * block), jEnd = std::min(n, (tj + 1) * block);
+      size_t kEnd = std::min(n, (tk + 1) * block), j0 = tj * block;
+      for (size_t k = tk * block; k < kEnd; k++) {
+	for (size_t i = ti * block; i < iEnd; i++) {
+	  T a = D[i * n + k];
+	  if (a == Node<T>::INFINITY) { continue; }
+	  MinPlus<T>::update(D + i * n + j0, D + k * n + j0, a, jEnd - j0);
 	}
       }
+    };
+
+    {
+      GRAPH_PHASE(main);
+      for (size_t tk = 0; tk < tiles; tk++) {
+	relax(tk, tk, tk);
+
+	// Tiles in the row and column of the diagonal tile
+	pool.parallelFor(0, 2 * tiles, [&](size_t b, size_t e, unsigned) {
+	    for (size_t t = b; t < e; t++) {
+	      size_t other = t / 2;
+	      if (other == tk) { continue; }
+	      if (t % 2 == 0) { relax(tk, other, tk); }
+	      else { relax(other, tk, tk); }
+	    }
+	  }, 1);
+
+	// Every other tile only reads the row and column tiles, which are final
+	pool.parallelFor(0, tiles * tiles, [&](size_t b, size_t e, unsigned) {
+	    for (size_t t = b; t < e; t++) {
+	      size_t ti = t / tiles, tj = t % tiles;
+	      if (ti == tk || tj == tk) { continue; }
+	      relax(ti, tj, tk);
+	    }
+	  }, 1);
+      }
+    }
+
+    // Checks for Negative Cycle, which leaves a node with a negative distance to itself
+    GRAPH_PHASE(check);
+    for (size_t i = 0; i < n; i++) {
+      if (D[i * n + i] < 0) {
+	throw std::runtime_error("Graph contains negative-weight cycle");
+      }
+    }
+  }
+
+  template<typename T, class Graph_T>
+  void FloydWarshall(const Graph_T &g, std::vector<T> &dist,
+		     unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    FloydWarshall(g, dist, pool);
+  }
+
+  /*
+   * Finds the all-pairs shortest path
+   */
+  template<typename T, class Graph_T>
+  void FloydWarshall(const Graph_T &g, std::vector<std::vector<T> > &dist) {
+    std::vector<T> flat;
+    FloydWarshall(g, flat);
+
+    // Vector reference gets passed in from outside method
+    const size_t n = g.size();
+    dist.assign(n, std::vector<T>(n));
+    for (size_t i = 0; i < n; i++) {
+      std::copy(flat.begin() + i * n, flat.begin() + (i + 1) * n, dist[i].begin());
     }
-    
+  }
+
+  /*
+   * Finds the all-pairs shortest path of a sparse graph with Johnson's
+   * algorithm. A queue-based Bellman-Ford from a virtual source gives every
+   * node a potential h, edges are reweighted once to w + h[u] - h[v] >= 0,
+   * and then one Dijkstra per source runs on the pool.
+   *
+   * Instead of building a matrix, every source's distances are handed to
+   * row(src, dist) as soon as they are known, with INFINITY for unreachable
+   * nodes. row is called concurrently from the pool's threads, in no
+   * particular order of sources.
+   */
+  template<class Graph_T, class Function>
+  void Johnson(const Graph_T &g, Function row, ThreadPool &pool) {
+    typedef decltype(g.node(0)->getWeight()) T;
+    const size_t n = g.size();
+
+    std::vector<int> sources;
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) != nullptr) { sources.push_back(i); }
+    }
+
+    QueryContext<T> potential(n);
+    if (!BellmanFordQueue(g, sources, potential).empty()) {
+      throw std::runtime_error("Graph contains negative-weight cycle");
+    }
+
+    // Rounding can leave a reweighted edge of a shortest path slightly below zero
+    CSRGraph<T> reweighted = CSRGraph<T>(g).reweighted([&](int from, int to, T w) {
+	T w2 = w + potential.distance(from) - potential.distance(to);
+	return (w2 < 0) ? (T) 0 : w2;
+      });
+
+    std::vector<QueryContext<T> > contexts(pool.size(), QueryContext<T>(n));
+    std::vector<IndexedHeap<T> > heaps(pool.size(), IndexedHeap<T>(n));
+    std::vector<std::vector<T> > rows(pool.size(), std::vector<T>(n));
+
+    pool.parallelFor(0, sources.size(), [&](size_t b, size_t e, unsigned id) {
+	for (size_t i = b; i < e; i++) {
+	  int src = sources[i];
+	  Dijkstra(reweighted, src, contexts[id], heaps[id]);
+
+	  std::vector<T> &dist = rows[id];
+	  for (size_t v = 0; v < n; v++) {
+	    T d = contexts[id].distance(v);
+	    dist[v] = (d == Node<T>::INFINITY) ? d :
+	      d - potential.distance(src) + potential.distance(v);
+	  }
+	  row(src, (const std::vector<T> &) dist);
+	}
+      }, 1);
+  }
+
+  /*
+   * Finds the all-pairs shortest path with Johnson's algorithm into a
+   * row-major n x n matrix, laid out like the one from FloydWarshall
+   */
+  template<typename T, class Graph_T>
+  void Johnson(const Graph_T &g, std::vector<T> &dist,
+	       unsigned threads = ThreadPool::hardwareThreads()) {
+    const size_t n = g.size();
+    dist.assign(n * n, Node<T>::INFINITY);
+
+    ThreadPool pool(threads);
+    Johnson(g, [&](int src, const std::vector<T> &row) {
+	std::copy(row.begin(), row.end(), dist.begin() + src * n);
+      }, pool);
+  }
+
+  /*
+   * Finds the all-pairs shortest path with Johnson's algorithm and writes
+   * one line per source, "src: d0 d1 ...", with NA for unreachable nodes.
+   * Lines come in the order the sources finish.
+   */
+  template<class Graph_T>
+  void Johnson(const Graph_T &g, std::ostream &out,
+	       unsigned threads = ThreadPool::hardwareThreads()) {
+    typedef decltype(g.node(0)->getWeight()) T;
+    std::mutex lock;
+
+    ThreadPool pool(threads);
+    Johnson(g, [&](int src, const std::vector<T> &row) {
+	std::ostringstream line; // formatted outside of the lock
+	line << src << ":";
+	for (auto d : row) {
+	  if (d == Node<T>::INFINITY) { line << " NA"; }
+	  else { line << " " << d; }
+	}
+	line << "\n";
+
+	std::lock_guard<std::mutex> guard(lock);
+	out << line.str();
+      }, pool);
   }
 }
 
 
 /*
- * Prints the path of node ID's given the source, destination, and a vector showing each node's
- * previous node in the order of traversal
+ * Determines if the graph contains a negative-weight cycle
  */
 template<typename T>
-void printPath (Node<T> *src, Node<T> *dest, const std::vector<Node<T>* > &prev) {
-  Node<T>* nodePtr = dest;
-  
-  std::vector<int> path; // traces the path by following vector of previous nodes
-  path.push_back(nodePtr->getID());
-    
-  while (nodePtr != src) {
-    nodePtr = prev[nodePtr->getID()];
-    path.push_back(nodePtr->getID());
-  }
-  
-  reverse(path.begin(), path.end()); // reverses the path to start with source node
-  
+bool hasNegativeCycle(const AdjacencyList<T> &g) {
+  return !graph::NegativeCycle(g).empty();
+}
+
+template<typename T>
+bool hasNegativeCycle(const AdjacencyMatrix<T> &g) {
+  return !graph::NegativeCycle(g).empty();
+}
+
+template<typename T>
+bool hasNegativeCycle(const CSRGraph<T> &g) {
+  return !graph::NegativeCycle(g).empty();
+}
+
+/*
+ * Prints a path of node ID's, from the source to the destination
+ */
+inline void printPath(const std::vector<int> &path) {
+  if (path.empty()) { // destination was not reached
+    std::cout << "()";
+    return;
+  }
+
   std::cout << "(";
   // prints each node ID, followed by the delimiter '->'
   copy(path.begin(), path.end()-1, std:: ostream_iterator<int>(std::cout, " -> "));
   std::cout << path.back() << ")"; //prints last element without '->'
-}  
+}
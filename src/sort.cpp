@@ -1,61 +1,146 @@
 #include "../include/AdjacencyList.hh"
 #include "../include/AdjacencyMatrix.hh"
+#include "../include/CSRGraph.hh"
+#include "../include/ThreadPool.hh"
+#include "../include/Stats.hh"
+
+#include <atomic>
 
 namespace graph {
   /*
-   * Finds a topological sort of the graph
+   * Finds a topological sort of the graph in O(V + E): in-degrees are counted
+   * in one pass over the edges, and the graph has a cycle exactly when some
+   * nodes never reach in-degree zero
    */
   template <typename T, class Graph_T>
-  std::vector<Node<T>* > TopologicalSort(Graph_T &g) {
+  std::vector<Node<T>* > TopologicalSort(const Graph_T &g) {
     if (!g.isDirected()) { throw std::invalid_argument("Graph must be directed."); }
+    GRAPH_STATS_START();
+
+    std::vector<size_t> nodeDegrees(g.size(), 0);
 
-    g.reset();
-    
-    std::map<int, size_t> nodeDegrees;
-    
     std::queue<Node<T>* > nodeQ; // Nodes with no incoming edges
-    std::set<EdgePtr<T> > edges; // Checks visited edges
     std::vector<Node<T>* > order; // Topological sorting
-    
-    Node<T>* nodePtr;
-    // Preprocessing: Compute incoming degree of all nodes
-    for (size_t i = 0; i < g.size(); i++) {
-      nodePtr = g.node(i);
-
-      nodeQ.push(nodePtr);
-      nodeDegrees[nodePtr->getID()] = g.inDegree(nodePtr);      
-      if (g.inDegree(nodePtr) == 0) { nodeQ.push(nodePtr); }
+
+    size_t nNodes = 0;
+    {
+      GRAPH_PHASE(reset);
+      // Preprocessing: Compute incoming degree of all nodes
+      for (size_t i = 0; i < g.size(); i++) {
+	if (g.node(i) == nullptr) { continue; }
+	nNodes++;
+	for (auto& edge : g.adjacent(g.node(i))) {
+	  nodeDegrees[edge->getEnd()->getID()]++;
+	  GRAPH_COUNT(scanned);
+	}
+      }
+
+      for (size_t i = 0; i < g.size(); i++) {
+	if (g.node(i) != nullptr && nodeDegrees[i] == 0) { nodeQ.push(g.node(i)); }
+      }
     }
-    
-    while (!nodeQ.empty()) {
-      nodePtr = nodeQ.front();
-      nodeQ.pop();
-      
-      order.push_back(nodePtr);
-      for (auto& edge: g.adjacent(nodePtr)) {
-	// Checks for cycles in the graph
-	auto insert_result = edges.insert(edge);
-	if (!insert_result.second) { throw std::runtime_error("Graph contains cycle."); }
-	
-	Node<T> *neighbor = edge->getEnd();
-	nodeDegrees[neighbor->getID()]--;
-	if (nodeDegrees[neighbor->getID()] == 0) {
-	  nodeQ.push(neighbor);
+
+    {
+      GRAPH_PHASE(main);
+      while (!nodeQ.empty()) {
+	Node<T> *nodePtr = nodeQ.front();
+	nodeQ.pop();
+
+	order.push_back(nodePtr);
+	GRAPH_COUNT(settled);
+	for (auto& edge: g.adjacent(nodePtr)) {
+	  Node<T> *neighbor = edge->getEnd();
+	  GRAPH_COUNT(scanned);
+	  if (--nodeDegrees[neighbor->getID()] == 0) {
+	    nodeQ.push(neighbor);
+	  }
 	}
-      } 
+      }
     }
-	
+
+    // Nodes on a cycle never run out of incoming edges
+    GRAPH_PHASE(check);
+    if (order.size() < nNodes) { throw std::runtime_error("Graph contains cycle."); }
+
     return order;
   }
 
+  /*
+   * Finds a topological sort of the graph one layer at a time: layer 0 holds
+   * the nodes without incoming edges, and layer i + 1 the nodes whose last
+   * incoming edge comes from layer i. The nodes of a layer are independent,
+   * so each layer is processed in parallel.
+   *
+   * Layer i is order[layers[i], layers[i + 1]).
+   */
+  template <class Graph_T>
+  void ParallelTopologicalSort(const Graph_T &g, std::vector<int> &order,
+			       std::vector<size_t> &layers, ThreadPool &pool) {
+    if (!g.isDirected()) { throw std::invalid_argument("Graph must be directed."); }
+
+    const size_t n = g.size();
+    std::vector<std::atomic<int> > nodeDegrees(n); // value-initialized to zero
+    std::vector<std::vector<int> > found(pool.size());
+
+    pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) {
+	  if (g.node(i) == nullptr) { continue; }
+	  for (auto& edge : g.adjacent(g.node(i))) {
+	    nodeDegrees[edge->getEnd()->getID()].fetch_add(1, std::memory_order_relaxed);
+	  }
+	}
+      });
+
+    size_t nNodes = 0;
+    order.clear();
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) == nullptr) { continue; }
+      nNodes++;
+      if (nodeDegrees[i].load(std::memory_order_relaxed) == 0) { order.push_back(i); }
+    }
+
+    layers.assign(1, 0);
+    while (layers.back() < order.size()) {
+      size_t first = layers.back(), last = order.size();
+      layers.push_back(last);
+
+      // Whichever thread removes the last incoming edge of a node emits it
+      pool.parallelFor(first, last, [&](size_t b, size_t e, unsigned id) {
+	  for (size_t i = b; i < e; i++) {
+	    for (auto& edge : g.adjacent(g.node(order[i]))) {
+	      int next = edge->getEnd()->getID();
+	      if (nodeDegrees[next].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		found[id].push_back(next);
+	      }
+	    }
+	  }
+	}, 256);
+
+      for (auto& f : found) {
+	order.insert(order.end(), f.begin(), f.end());
+	f.clear();
+      }
+    }
+
+    // Nodes on a cycle never run out of incoming edges
+    if (order.size() < nNodes) { throw std::runtime_error("Graph contains cycle."); }
+  }
+
+  template <class Graph_T>
+  void ParallelTopologicalSort(const Graph_T &g, std::vector<int> &order, std::vector<size_t> &layers,
+			       unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    ParallelTopologicalSort(g, order, layers, pool);
+  }
+
   /*
    * Determines if there is a cycle in the graph
    */
   template <typename T, class Graph_T>
-  bool hasCycle(Graph_T &g) {
+  bool hasCycle(const Graph_T &g) {
     try {
       std::vector<Node<T>* > toposorted = TopologicalSort<T>(g);
-    } 
+    }
     catch (std::runtime_error &e) {
       return true;
     }
@@ -0,0 +1,275 @@
+#include "../include/AdjacencyList.hh"
+#include "../include/AdjacencyMatrix.hh"
+#include "../include/CSRGraph.hh"
+#include "../include/IndexedHeap.hh"
+#include "../include/ThreadPool.hh"
+#include "../include/UnionFind.hh"
+
+#include <atomic>
+#include <algorithm>
+
+namespace graph {
+
+  /*
+   * Undirected edge of a spanning forest
+   */
+  template<typename T>
+  struct WeightedEdge {
+    int from;
+    int to;
+    T weight;
+  };
+
+  /*
+   * Edges and total weight of a minimum spanning forest, which holds a
+   * minimum spanning tree of every connected component
+   */
+  template<typename T>
+  struct SpanningForest {
+    std::vector<WeightedEdge<T> > edges;
+    T weight;
+
+    SpanningForest() : edges(), weight(0) {}
+
+    inline void clear() {
+      edges.clear();
+      weight = 0;
+    }
+
+    inline void add(const WeightedEdge<T> &e) {
+      edges.push_back(e);
+      weight += e.weight;
+    }
+  };
+
+  /*
+   * Orders edges by weight, then by end points, so that every algorithm
+   * breaks ties between equal weights the same way
+   */
+  template<typename T>
+  inline bool lighter(const WeightedEdge<T> &a, const WeightedEdge<T> &b) {
+    if (a.weight != b.weight) { return a.weight < b.weight; }
+    return (a.from != b.from) ? a.from < b.from : a.to < b.to;
+  }
+
+  /*
+   * Lists every undirected edge once, from its smaller end ID, in parallel
+   * over the nodes. Self-loops are left out.
+   */
+  template<typename T, class Graph_T>
+  void spanningEdges(const Graph_T &g, std::vector<WeightedEdge<T> > &edges, ThreadPool &pool) {
+    if (g.isDirected()) { throw std::invalid_argument("Graph must be undirected."); }
+
+    const size_t n = g.size();
+    std::vector<size_t> offsets(n + 1, 0);
+    pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) {
+	  if (g.node(i) == nullptr) { continue; }
+	  for (auto& edge : g.adjacent(g.node(i))) {
+	    if ((size_t) edge->getEnd()->getID() > i) { offsets[i + 1]++; }
+	  }
+	}
+      });
+    for (size_t i = 0; i < n; i++) { offsets[i + 1] += offsets[i]; }
+
+    edges.resize(offsets[n]);
+    pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) {
+	  if (g.node(i) == nullptr) { continue; }
+	  size_t next = offsets[i];
+	  for (auto& edge : g.adjacent(g.node(i))) {
+	    int to = edge->getEnd()->getID();
+	    if ((size_t) to > i) { edges[next++] = WeightedEdge<T>{ (int) i, to, edge->getWeight() }; }
+	  }
+	}
+      });
+  }
+
+  /*
+   * Sorts one run per thread in parallel, then merges neighbouring runs,
+   * halving their number every round
+   */
+  template<class Iterator, class Compare>
+  void parallelSort(Iterator first, Iterator last, Compare less, ThreadPool &pool) {
+    const size_t n = last - first, runs = pool.size();
+    if (runs == 1 || n < 2 * runs) {
+      std::sort(first, last, less);
+      return;
+    }
+
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t r = 0; r <= runs; r++) { bounds[r] = n * r / runs; }
+
+    pool.parallelFor(0, runs, [&](size_t b, size_t e, unsigned) {
+	for (size_t r = b; r < e; r++) { std::sort(first + bounds[r], first + bounds[r + 1], less); }
+      }, 1);
+
+    for (size_t width = 1; width < runs; width *= 2) {
+      pool.parallelFor(0, (runs + 2 * width - 1) / (2 * width), [&](size_t b, size_t e, unsigned) {
+	  for (size_t pair = b; pair < e; pair++) {
+	    size_t lo = 2 * width * pair, mid = std::min(runs, lo + width), hi = std::min(runs, lo + 2 * width);
+	    std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], less);
+	  }
+	}, 1);
+    }
+  }
+
+  /*
+   * Finds a minimum spanning forest of an undirected graph with Kruskal's
+   * algorithm: the edges are sorted by weight in parallel, and each one is
+   * kept if it joins two trees of a union-find. The edges of the forest come
+   * out in order of weight.
+   */
+  template<typename T, class Graph_T>
+  void Kruskal(const Graph_T &g, SpanningForest<T> &forest, ThreadPool &pool) {
+    std::vector<WeightedEdge<T> > edges;
+    spanningEdges(g, edges, pool);
+    parallelSort(edges.begin(), edges.end(), lighter<T>, pool);
+
+    UnionFind trees(g.size());
+    forest.clear();
+    for (const auto &e : edges) {
+      if (trees.unite(e.from, e.to)) { forest.add(e); }
+    }
+  }
+
+  template<typename T, class Graph_T>
+  void Kruskal(const Graph_T &g, SpanningForest<T> &forest,
+	       unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    Kruskal(g, forest, pool);
+  }
+
+  /*
+   * Finds a minimum spanning forest of an undirected graph with Prim's
+   * algorithm, growing one tree at a time from its smallest node ID. The
+   * heap holds every node next to the tree, keyed by its lightest edge into
+   * the tree, so it never holds more than |V| entries.
+   */
+  template<typename T, class Graph_T>
+  void Prim(const Graph_T &g, SpanningForest<T> &forest) {
+    if (g.isDirected()) { throw std::invalid_argument("Graph must be undirected."); }
+
+    const size_t n = g.size();
+    IndexedHeap<T> heap(n);
+    std::vector<bool> inTree(n, false);
+    std::vector<int> link(n, -1); // tree node at the other end of the lightest edge
+    std::vector<T> weight(n, Node<T>::INFINITY);
+
+    forest.clear();
+    for (size_t root = 0; root < n; root++) {
+      if (g.node(root) == nullptr || inTree[root]) { continue; }
+      heap.push(root, (T) 0);
+
+      while (!heap.empty()) {
+	int top = heap.pop();
+	inTree[top] = true;
+	if (link[top] != -1) { forest.add(WeightedEdge<T>{ link[top], top, weight[top] }); }
+
+	for (auto& edge : g.adjacent(g.node(top))) {
+	  int next = edge->getEnd()->getID();
+	  if (inTree[next] || edge->getWeight() >= weight[next]) { continue; }
+	  weight[next] = edge->getWeight();
+	  link[next] = top;
+	  if (heap.contains(next)) { heap.decrease(next, weight[next]); }
+	  else { heap.push(next, weight[next]); }
+	}
+      }
+    }
+  }
+
+  /*
+   * Finds a minimum spanning forest of an undirected graph with Borůvka's
+   * algorithm. Every round, each component picks its lightest outgoing edge
+   * in parallel, the picked edges merge components in a lock-free
+   * union-find, and the edge list is contracted: edges inside a component
+   * are dropped and the rest are relabelled with component IDs. Ties are
+   * broken by edge index, so the picked edges never close a cycle.
+   * Each round at least halves the number of components, so there are at
+   * most log |V| rounds.
+   */
+  template<typename T, class Graph_T>
+  void Boruvka(const Graph_T &g, SpanningForest<T> &forest, ThreadPool &pool) {
+    const size_t n = g.size();
+    std::vector<WeightedEdge<T> > edges;
+    spanningEdges(g, edges, pool);
+
+    // Edge between two components, by index into edges
+    struct Arc {
+      int from;
+      int to;
+      size_t id;
+    };
+    std::vector<Arc> arcs(edges.size()), kept;
+    pool.parallelFor(0, edges.size(), [&](size_t b, size_t e, unsigned) {
+	for (size_t i = b; i < e; i++) { arcs[i] = Arc{ edges[i].from, edges[i].to, i }; }
+      });
+
+    UnionFind trees(n);
+    std::vector<std::atomic<size_t> > lightest(n); // index into arcs, or NONE
+    const size_t NONE = (size_t) -1;
+    std::vector<std::vector<size_t> > picked(pool.size()), survivors(pool.size());
+
+    // Whether arc a is lighter than arc b, ties broken by edge index
+    auto lighterArc = [&](size_t a, size_t b) {
+      const T wa = edges[arcs[a].id].weight, wb = edges[arcs[b].id].weight;
+      return wa < wb || (wa == wb && arcs[a].id < arcs[b].id);
+    };
+
+    auto offer = [&](int component, size_t a) {
+      size_t current = lightest[component].load(std::memory_order_relaxed);
+      while ((current == NONE || lighterArc(a, current)) &&
+	     !lightest[component].compare_exchange_weak(current, a, std::memory_order_relaxed)) {}
+    };
+
+    forest.clear();
+    while (!arcs.empty()) {
+      pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned) {
+	  for (size_t i = b; i < e; i++) { lightest[i].store(NONE, std::memory_order_relaxed); }
+	}, 4096);
+
+      pool.parallelFor(0, arcs.size(), [&](size_t b, size_t e, unsigned) {
+	  for (size_t a = b; a < e; a++) {
+	    offer(arcs[a].from, a);
+	    offer(arcs[a].to, a);
+	  }
+	}, 4096);
+
+      // An arc picked by both of its components joins them only once
+      pool.parallelFor(0, n, [&](size_t b, size_t e, unsigned tid) {
+	  for (size_t c = b; c < e; c++) {
+	    size_t a = lightest[c].load(std::memory_order_relaxed);
+	    if (a != NONE && trees.unite(arcs[a].from, arcs[a].to)) { picked[tid].push_back(arcs[a].id); }
+	  }
+	}, 4096);
+      for (auto& p : picked) {
+	for (size_t id : p) { forest.add(edges[id]); }
+	p.clear();
+      }
+
+      // Contracts the arcs, keeping those between different components
+      pool.parallelFor(0, arcs.size(), [&](size_t b, size_t e, unsigned tid) {
+	  for (size_t a = b; a < e; a++) {
+	    int from = trees.find(arcs[a].from), to = trees.find(arcs[a].to);
+	    if (from == to) { continue; }
+	    arcs[a].from = from;
+	    arcs[a].to = to;
+	    survivors[tid].push_back(a);
+	  }
+	}, 4096);
+      kept.clear();
+      for (auto& s : survivors) {
+	for (size_t a : s) { kept.push_back(arcs[a]); }
+	s.clear();
+      }
+      arcs.swap(kept);
+    }
+  }
+
+  template<typename T, class Graph_T>
+  void Boruvka(const Graph_T &g, SpanningForest<T> &forest,
+	       unsigned threads = ThreadPool::hardwareThreads()) {
+    ThreadPool pool(threads);
+    Boruvka(g, forest, pool);
+  }
+}
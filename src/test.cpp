@@ -1,48 +1,905 @@
+#include "components.cpp"
+#include "pagerank.cpp"
 #include "shortest_path.cpp"
 #include "search.cpp"
 #include "sort.cpp"
+#include "spanning_tree.cpp"
+#include "../include/ContractionHierarchy.hh"
+#include "../include/DynamicSSSP.hh"
+#include "../include/StreamingGraph.hh"
 
 #include <iomanip>
+#include <set>
+#include <unistd.h>
 
 using namespace std;
 using namespace graph;
 
 /*
- * Only tests the Adjacency List representation, but testing the Adjacency Matrix representation
- * should theoretically be identical
+ * Writes the stats of the last algorithm as a line of JSON to standard
+ * error, when built with make STATS=1
  */
-int main(int argc, char *argv[]) {
- 
-  ifstream f;
-  bool hasFile = false;
+inline void dumpStats(const string &algorithm) {
+#ifdef GRAPH_STATS
+  cerr << "{\"algorithm\": \"" << algorithm << "\", \"stats\": " << Stats::local().json() << "}" << endl;
+#else
+  (void) algorithm;
+#endif
+}
 
-  string usage = "Usage: " + string(argv[0]) + " -f <filename>";
+/*
+ * Returns the edges of a graph in the text format of the constructors, with
+ * every weight made non-negative
+ */
+template <class Graph_T>
+string absoluteEdges(const Graph_T &g) {
+  ostringstream edges;
+  size_t nEdges = 0;
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) == nullptr) { continue; }
+    for (auto& edge : g.adjacent(g.node(i))) {
+      edges << i << " " << edge->getEnd()->getID() << " " << abs(edge->getWeight()) << "\n";
+      nEdges++;
+    }
+  }
+  return to_string(g.size()) + " " + to_string(nEdges) + "\n" + edges.str();
+}
 
-  if (argc > 1) {
-    if (string(argv[1]) != "-f") {
-      cerr << usage << endl;
-      return -1;
+/*
+ * Returns the weight of a path, or INFINITY if two consecutive nodes are
+ * not joined by an edge
+ */
+template <class Graph_T>
+double pathWeight(const Graph_T &g, const vector<int> &nodes) {
+  double weight = 0;
+  for (size_t i = 1; i < nodes.size(); i++) {
+    double lightest = Node<double>::INFINITY;
+    for (auto& edge : g.adjacent(g.node(nodes[i - 1]))) {
+      if (edge->getEnd()->getID() == nodes[i]) { lightest = min(lightest, edge->getWeight()); }
     }
-    
-    f.open(argv[2]);
-    if (!f.good()) {
-      cerr << "Couldn't open file " << argv[2] << endl;
-      cerr << usage << endl;
-      return -1;
+    if (lightest == Node<double>::INFINITY) { return lightest; }
+    weight += lightest;
+  }
+  return weight;
+}
+
+/*
+ * Overwrites bytes of a file written by save() and checks that loading it
+ * as Loaded_T without the checksum still throws
+ */
+template <class Loaded_T, typename V>
+void checkCorruptFile(const string &file, size_t offset, V value, const string &corruption) {
+  fstream out(file, ios::in | ios::out | ios::binary);
+  out.seekp(offset);
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  out.close();
+
+  try {
+    Loaded_T::load(file, false);
+  }
+  catch (const runtime_error &) {
+    return;
+  }
+  throw runtime_error("File with " + corruption + " loaded without an error");
+}
+
+/*
+ * Checks the distances and paths of a contraction hierarchy of a graph with
+ * non-negative weights against Dijkstra for every pair of nodes, before and
+ * after a round trip through a file. Then checks that files with impossible
+ * sizes, ranks, offsets or arc nodes are rejected even without the checksum.
+ */
+template <class Graph_T>
+void checkContractionHierarchy(const Graph_T &g) {
+  ContractionHierarchy<double> built(g);
+
+  char file[] = "/tmp/graph-test-XXXXXX";
+  int fd = mkstemp(file);
+  if (fd == -1) { throw runtime_error("Couldn't create a temporary file"); }
+  close(fd);
+  built.save(file);
+  ContractionHierarchy<double> loaded = ContractionHierarchy<double>::load(file);
+
+  HierarchyHeader header;
+  ifstream in(file, ios::binary);
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  in.close();
+
+  // Sections of the up arcs, which come first
+  const size_t n = header.nNodes, rank = sizeof(HierarchyHeader);
+  const size_t offsets = rank + Snapshot::padded(n * sizeof(int)), targets = offsets + (n + 1) * sizeof(uint64_t);
+  const size_t middles = targets + Snapshot::padded(header.nUp * sizeof(int));
+  try {
+    typedef ContractionHierarchy<double> Loaded_T;
+    checkCorruptFile<Loaded_T>(file, offsetof(HierarchyHeader, nNodes), (uint64_t) -1,
+			       "a node count that overflows");
+    built.save(file);
+    checkCorruptFile<Loaded_T>(file, offsetof(HierarchyHeader, nUp), (uint64_t) 1 << 62,
+			       "an arc count that overflows");
+    built.save(file);
+    checkCorruptFile<Loaded_T>(file, offsets, (uint64_t) 1, "a first offset other than 0");
+    if (n >= 1) {
+      built.save(file);
+      checkCorruptFile<Loaded_T>(file, rank, (int32_t) n, "a rank past the last node");
     }
-    
-    hasFile = true;
+    if (n >= 2 && header.nUp >= 1) {
+      built.save(file);
+      checkCorruptFile<Loaded_T>(file, offsets + sizeof(uint64_t), (uint64_t) header.nUp + 1,
+				 "decreasing offsets");
+      built.save(file);
+      checkCorruptFile<Loaded_T>(file, targets, (int32_t) n, "a target past the last node");
+      built.save(file);
+      checkCorruptFile<Loaded_T>(file, middles, (int32_t) -2, "a middle before the first node");
+    }
+  }
+  catch (...) {
+    remove(file);
+    throw;
   }
+  remove(file);
 
-  istream &in = hasFile ? f : cin;
-  
-  auto my_graph = AdjacencyList<double>(in, true);
+  QueryContext<double> ctx(g.size());
+  for (size_t src = 0; src < g.size(); src++) {
+    for (size_t dest = 0; dest < g.size(); dest++) {
+      if (g.node(src) == nullptr || g.node(dest) == nullptr) { continue; }
+      Path<double> expected = Dijkstra(g, src, dest, ctx);
+
+      for (const ContractionHierarchy<double> *ch : { &built, &loaded }) {
+	vector<int> path = ch->path(src, dest);
+	bool samePath = expected.nodes.empty() ? path.empty() :
+	  (!path.empty() && path.front() == (int) src && path.back() == (int) dest &&
+	   pathWeight(g, path) == expected.distance);
+	if (ch->distance(src, dest) != expected.distance || !samePath) {
+	  throw runtime_error("Contraction hierarchy differs from Dijkstra from " + to_string(src) +
+			      " to " + to_string(dest) + (ch == &loaded ? " after loading" : ""));
+	}
+      }
+    }
+  }
+}
+
+/*
+ * Checks that a snapshot of a graph loads with the same edges, and that
+ * snapshots with impossible sizes, offsets or targets are rejected even
+ * without the checksum
+ */
+template <class Graph_T>
+void checkSnapshot(const Graph_T &g) {
+  const CSRGraph<double> csr(g);
+  const size_t n = csr.size(), nEdges = csr.numEdges();
+
+  char file[] = "/tmp/graph-test-XXXXXX";
+  int fd = mkstemp(file);
+  if (fd == -1) { throw runtime_error("Couldn't create a temporary file"); }
+  close(fd);
+
+  csr.save(file);
+  const CSRGraph<double> loaded = CSRGraph<double>::load(file);
+  if (absoluteEdges(loaded) != absoluteEdges(csr) || loaded.isDirected() != csr.isDirected()) {
+    remove(file);
+    throw runtime_error("Snapshot differs from the graph after loading");
+  }
+
+  const size_t offsets = sizeof(SnapshotHeader), targets = offsets + (n + 1) * sizeof(uint64_t);
+  try {
+    typedef CSRGraph<double> Loaded_T;
+    checkCorruptFile<Loaded_T>(file, offsetof(SnapshotHeader, nNodes), (uint64_t) -1,
+			       "a node count that overflows");
+    csr.save(file);
+    checkCorruptFile<Loaded_T>(file, offsetof(SnapshotHeader, nEdges), (uint64_t) 1 << 62,
+			       "an edge count that overflows");
+    csr.save(file);
+    checkCorruptFile<Loaded_T>(file, offsets, (uint64_t) 1, "a first offset other than 0");
+    if (n >= 2 && nEdges >= 1) {
+      csr.save(file);
+      checkCorruptFile<Loaded_T>(file, offsets + sizeof(uint64_t), (uint64_t) nEdges + 1,
+				 "decreasing offsets");
+      csr.save(file);
+      checkCorruptFile<Loaded_T>(file, targets, (int32_t) n, "a target past the last node");
+      csr.save(file);
+      checkCorruptFile<Loaded_T>(file, targets, (int32_t) -1, "a negative target");
+    }
+  }
+  catch (...) {
+    remove(file);
+    throw;
+  }
+  remove(file);
+}
+
+/*
+ * Checks multi-source BFS against one BFS per source. Every node is a
+ * source many times over, so the sources include duplicates and fill more
+ * than one 64-bit word of a batch, and with one-word batches more than one
+ * batch.
+ */
+template <class Graph_T>
+void checkMultiSourceBFS(const Graph_T &g) {
+  vector<int> sources;
+  for (size_t i = 0; sources.size() < 130 && i < 130 * g.size(); i++) {
+    if (g.node(i % g.size()) != nullptr) { sources.push_back(i % g.size()); }
+  }
+
+  vector<vector<int> > depth, oneWord(sources.size(), vector<int>(g.size(), -1));
+  MultiSourceBFS(g, sources, depth);
+  MultiSourceBFS<1>(g, sources, [&](size_t i, int id, int d) { oneWord[i][id] = d; });
+
+  QueryContext<double> ctx(g.size());
+  for (size_t i = 0; i < sources.size(); i++) {
+    BFS(g, sources[i], ctx);
+    for (size_t id = 0; id < g.size(); id++) {
+      int hops = (ctx.parent(id) == -1) ? -1 : (int) ctx.distance(id);
+      if (depth[i][id] != hops || oneWord[i][id] != hops) {
+	throw runtime_error("Multi-source BFS differs from BFS from " + to_string(sources[i]) +
+			    " to " + to_string(id));
+      }
+    }
+  }
+}
+
+/*
+ * Returns whether dest is reachable from src
+ */
+template <class Graph_T>
+bool reaches(const Graph_T &g, int src, int dest, QueryContext<double> &ctx) {
+  BFS(g, src, ctx);
+  return ctx.parent(dest) != -1;
+}
+
+/*
+ * Checks the depths of parallel BFS against BFS from every node, with one
+ * and four threads, bottom-up steps over the transpose and top-down only.
+ * Every parent must be one level above its child.
+ */
+template <class Graph_T>
+void checkParallelBFS(const Graph_T &g) {
+  const CSRGraph<double> reverse = CSRGraph<double>(g).transpose();
+  QueryContext<double> ctx(g.size());
+  BFSTree tree;
+
+  for (unsigned threads : { 1, 4 }) {
+    ThreadPool pool(threads);
+    for (size_t src = 0; src < g.size(); src++) {
+      if (g.node(src) == nullptr) { continue; }
+      BFS(g, src, ctx);
+      for (const CSRGraph<double> *r : { &reverse, (const CSRGraph<double> *) nullptr }) {
+	ParallelBFS(g, r, src, tree, pool);
+	for (size_t id = 0; id < g.size(); id++) {
+	  int hops = (ctx.parent(id) == -1) ? -1 : (int) ctx.distance(id);
+	  int p = tree.parent[id];
+	  if (tree.depth[id] != hops || (hops > 0 && tree.depth[p] != hops - 1)) {
+	    throw runtime_error("Parallel BFS differs from BFS from " + to_string(src) + " to " +
+				to_string(id) + " with " + to_string(threads) + " threads" +
+				(r == nullptr ? ", top-down only" : ""));
+	  }
+	}
+      }
+    }
+  }
+}
+
+/*
+ * Checks the distances of delta-stepping against Dijkstra from every node,
+ * for each bucket width and with one and four threads
+ */
+template <typename T, class Graph_T>
+void checkDeltaStepping(const Graph_T &g, const vector<T> &deltas) {
+  QueryContext<T> ctx(g.size());
+  PathTree<T> tree;
+
+  for (size_t src = 0; src < g.size(); src++) {
+    if (g.node(src) == nullptr) { continue; }
+    Dijkstra(g, src, ctx);
+    for (T delta : deltas) {
+      for (unsigned threads : { 1, 4 }) {
+	DeltaStepping(g, src, delta, tree, threads);
+	for (size_t id = 0; id < g.size(); id++) {
+	  if (tree.distance[id] != ctx.distance(id)) {
+	    throw runtime_error("Delta-stepping differs from Dijkstra from " + to_string(src) + " to " +
+				to_string(id) + " with delta " + to_string(delta));
+	  }
+	}
+      }
+    }
+  }
+}
+
+/*
+ * Returns a directed adjacency list with the nodes and edges of a graph, for
+ * checks that add edges to it
+ */
+template <class Graph_T>
+AdjacencyList<double> copyGraph(const Graph_T &g) {
+  AdjacencyList<double> copy(true);
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) != nullptr) { copy.addNode(i); }
+  }
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) == nullptr) { continue; }
+    for (auto& edge : g.adjacent(g.node(i))) {
+      copy.addEdge(i, edge->getEnd()->getID(), edge->getWeight());
+    }
+  }
+  return copy;
+}
+
+/*
+ * Checks that a negative-weight cycle follows the edges of a graph and that
+ * its weight is negative
+ */
+template <class Graph_T>
+void checkNegativeCycle(const Graph_T &g, vector<int> cycle) {
+  if (cycle.empty()) { throw runtime_error("No negative-weight cycle found"); }
+  cycle.push_back(cycle.front());
+  if (!(pathWeight(g, cycle) < 0)) {
+    throw runtime_error("Negative-weight cycle does not follow the edges or has a weight of " +
+			to_string(pathWeight(g, cycle)));
+  }
+}
+
+/*
+ * Checks queue-based Bellman-Ford against Bellman-Ford from every node of a
+ * graph without negative-weight cycles. Then closes every shortest path with
+ * an edge back to its source, light enough to make the cycle negative, and
+ * checks that both NegativeCycle and Bellman-Ford from the source find one.
+ */
+template <class Graph_T>
+void checkNegativeCycles(const Graph_T &g) {
+  if (!NegativeCycle(g).empty()) { throw runtime_error("Negative-weight cycle found in a graph without one"); }
+
+  QueryContext<double> ctx(g.size()), queue(g.size());
+  for (size_t src = 0; src < g.size(); src++) {
+    if (g.node(src) == nullptr) { continue; }
+    BellmanFord(g, src, ctx);
+    if (!BellmanFordQueue(g, src, queue).empty()) {
+      throw runtime_error("Queue-based Bellman-Ford found a negative-weight cycle from " + to_string(src));
+    }
+
+    for (size_t dest = 0; dest < g.size(); dest++) {
+      if (queue.distance(dest) != ctx.distance(dest)) {
+	throw runtime_error("Queue-based Bellman-Ford differs from Bellman-Ford from " + to_string(src) +
+			    " to " + to_string(dest));
+      }
+      if (dest == src || ctx.distance(dest) == Node<double>::INFINITY) { continue; }
+
+      AdjacencyList<double> closed = copyGraph(g);
+      closed.addEdge(dest, src, -ctx.distance(dest) - 1);
+
+      QueryContext<double> negative(g.size());
+      checkNegativeCycle(closed, NegativeCycle(closed));
+      checkNegativeCycle(closed, BellmanFordQueue(closed, src, negative));
+    }
+  }
+}
+
+/*
+ * Checks that two all-pairs distances agree up to a relative tolerance, for
+ * rounding from Johnson's reweighting or from printing
+ */
+inline void checkDistance(double johnson, double floyd, size_t src, size_t dest, double tolerance) {
+  if (johnson == floyd || (johnson != Node<double>::INFINITY && floyd != Node<double>::INFINITY &&
+			   abs(johnson - floyd) <= tolerance * max(1.0, abs(floyd)))) {
+    return;
+  }
+  throw runtime_error("Johnson differs from Floyd-Warshall from " + to_string(src) + " to " +
+		      to_string(dest));
+}
+
+/*
+ * Checks Johnson's matrix and the lines it streams, one per source, against
+ * the all-pairs distances of Floyd-Warshall
+ */
+template <class Graph_T>
+void checkJohnson(const Graph_T &g, const vector<vector<double> > &distances) {
+  const size_t n = g.size();
+  for (unsigned threads : { 1, 4 }) {
+    vector<double> dist;
+    Johnson(g, dist, threads);
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < n; j++) { checkDistance(dist[i * n + j], distances[i][j], i, j, 1e-9); }
+    }
+
+    ostringstream out;
+    Johnson(g, out, threads);
+    istringstream lines(out.str());
+    vector<bool> seen(n, false);
+    string line;
+    while (getline(lines, line)) {
+      istringstream fields(line);
+      size_t src;
+      char colon;
+      if (!(fields >> src >> colon) || colon != ':' || src >= n || seen[src]) {
+	throw runtime_error("Unexpected line from Johnson: " + line);
+      }
+      seen[src] = true;
+
+      string field;
+      for (size_t j = 0; j < n; j++) {
+	if (!(fields >> field)) { throw runtime_error("Short line from Johnson: " + line); }
+	double d = (field == "NA") ? Node<double>::INFINITY : stod(field);
+	checkDistance(d, distances[src][j], src, j, 1e-5); // printed with 6 significant digits
+      }
+      if (fields >> field) { throw runtime_error("Long line from Johnson: " + line); }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (seen[i] != (g.node(i) != nullptr)) {
+	throw runtime_error("Johnson wrote " + string(seen[i] ? "a" : "no") + " line for " + to_string(i));
+      }
+    }
+  }
+}
+
+/*
+ * Checks that a parallel topological sort of a cyclic graph throws
+ */
+template <class Graph_T>
+void checkCyclicTopologicalSort(const Graph_T &g) {
+  vector<int> order;
+  vector<size_t> layers;
+  try {
+    ParallelTopologicalSort(g, order, layers, 4);
+  }
+  catch (const runtime_error &) {
+    return;
+  }
+  throw runtime_error("Parallel topological sort of a cyclic graph did not throw");
+}
+
+/*
+ * Checks a parallel topological sort of an acyclic graph: the layers split
+ * the order, which holds every node once, and every edge goes to a later
+ * layer. Then checks that closing a cycle with a reverse edge makes it throw.
+ */
+template <class Graph_T>
+void checkParallelTopologicalSort(const Graph_T &g) {
+  if (hasCycle<double>(g)) {
+    checkCyclicTopologicalSort(g);
+    return;
+  }
+  const size_t n = g.size();
+  int first = -1, second = -1; // an edge to reverse
+
+  for (unsigned threads : { 1, 4 }) {
+    vector<int> order;
+    vector<size_t> layers;
+    ParallelTopologicalSort(g, order, layers, threads);
+
+    if (layers.empty() || layers.front() != 0 || layers.back() != order.size()) {
+      throw runtime_error("Layers do not cover the topological order");
+    }
+    vector<size_t> layer(n, layers.size());
+    for (size_t i = 0; i + 1 < layers.size(); i++) {
+      if (layers[i] >= layers[i + 1]) { throw runtime_error("Layer " + to_string(i) + " is empty"); }
+      for (size_t j = layers[i]; j < layers[i + 1]; j++) {
+	if (order[j] < 0 || (size_t) order[j] >= n || g.node(order[j]) == nullptr ||
+	    layer[order[j]] != layers.size()) {
+	  throw runtime_error("Topological order repeats or invents node " + to_string(order[j]));
+	}
+	layer[order[j]] = i;
+      }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (g.node(i) == nullptr) { continue; }
+      if (layer[i] == layers.size()) { throw runtime_error("Topological order misses node " + to_string(i)); }
+      for (auto& edge : g.adjacent(g.node(i))) {
+	int end = edge->getEnd()->getID();
+	if (layer[end] <= layer[i]) {
+	  throw runtime_error("Topological order puts " + to_string(end) + " before " + to_string(i));
+	}
+	first = i;
+	second = end;
+      }
+    }
+  }
+
+  if (first == -1) { return; } // no edges, so no cycle to close
+
+  AdjacencyList<double> cyclic = copyGraph(g);
+  cyclic.addEdge(second, first, 1);
+  checkCyclicTopologicalSort(cyclic);
+}
+
+/*
+ * Checks incoming() and inDegree() of every node against a scan of all the
+ * edges, after the given step of checkIncomingEdges
+ */
+template <class Graph_T>
+void checkIncoming(const Graph_T &g, const string &step) {
+  vector<multiset<pair<int, double> > > scanned(g.size());
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) == nullptr) { continue; }
+    for (auto& edge : g.adjacent(g.node(i))) {
+      scanned[edge->getEnd()->getID()].insert(make_pair((int) i, (double) edge->getWeight()));
+    }
+  }
+
+  for (size_t i = 0; i < g.size(); i++) {
+    if (g.node(i) == nullptr) { continue; }
+    multiset<pair<int, double> > incoming;
+    for (auto& edge : g.incoming(g.node(i))) {
+      if (edge->getEnd() != g.node(i)) {
+	throw runtime_error("Incoming edge of " + to_string(i) + " ends elsewhere after " + step);
+      }
+      incoming.insert(make_pair(edge->getStart()->getID(), (double) edge->getWeight()));
+    }
+    if (incoming != scanned[i] || g.inDegree(g.node(i)) != scanned[i].size()) {
+      throw runtime_error("Incoming edges of " + to_string(i) + " differ from a scan after " + step);
+    }
+  }
+}
+
+/*
+ * Adds and removes edges and nodes of a graph that tracks its incoming
+ * edges, including a self-loop and a repeated edge, and checks the incoming
+ * edges after every change
+ */
+template <class Graph_T>
+void checkIncomingEdges(Graph_T &g) {
+  const int n = g.size();
+  if (n < 2) { return; }
+  const int first = 0, middle = n / 2, last = n - 1;
+
+  checkIncoming(g, "construction");
+  g.addNode(first);
+  g.addNode(middle);
+  g.addNode(last);
+  g.addEdge(last, first, 3);
+  checkIncoming(g, "adding an edge");
+  g.addEdge(middle, middle, 1);
+  checkIncoming(g, "adding a self-loop");
+  g.addEdge(last, first, 4);
+  checkIncoming(g, "repeating an edge");
+  g.removeEdge(last, first);
+  checkIncoming(g, "removing an edge");
+  g.removeNode(middle);
+  checkIncoming(g, "removing a node");
+  g.addNode(middle);
+  g.addEdge(middle, first, 2);
+  g.addEdge(last, middle, 5);
+  checkIncoming(g, "adding the node back");
+  g.removeNode(first);
+  checkIncoming(g, "removing another node");
+}
+
+/*
+ * Checks that a view of a streaming graph holds exactly the edges of a
+ * reference, one multiset of (end, weight) per node
+ */
+inline void checkView(const StreamingGraph<double>::View &view,
+		      const vector<multiset<pair<int, double> > > &edges, const string &what) {
+  size_t nEdges = 0;
+  if (view.size() != edges.size()) { throw runtime_error(what + " has " + to_string(view.size()) + " nodes"); }
+  for (size_t i = 0; i < edges.size(); i++) {
+    multiset<pair<int, double> > adjacent;
+    for (auto& edge : view.adjacent(view.node(i))) {
+      adjacent.insert(make_pair(edge->getEnd()->getID(), edge->getWeight()));
+    }
+    if (adjacent != edges[i]) { throw runtime_error(what + " differs at node " + to_string(i)); }
+    nEdges += adjacent.size();
+  }
+  if (view.numEdges() != nEdges) {
+    throw runtime_error(what + " counts " + to_string(view.numEdges()) + " edges");
+  }
+}
+
+/*
+ * Replays random batches of insertions and deletions, some with new node
+ * IDs, on a streaming graph and on a reference. Every new view must match
+ * the reference, and views taken earlier must keep their edges.
+ */
+inline void checkStreamingGraph(bool directed, unsigned threads) {
+  uint64_t state = 1;
+  auto draw = [&](size_t bound) { // 64-bit LCG, the same on every platform
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (int) ((state >> 33) % bound);
+  };
+
+  StreamingGraph<double> g(20, directed, threads);
+  vector<multiset<pair<int, double> > > edges(20);
+  shared_ptr<const StreamingGraph<double>::View> first = g.snapshot(), previous = first;
+  vector<multiset<pair<int, double> > > firstEdges = edges, previousEdges = edges;
+
+  for (int b = 0; b < 40; b++) {
+    const int nNodes = 20 + b / 2; // every other batch may add a node
+    vector<EdgeUpdate<double> > batch;
+    for (int i = 0; i < 30; i++) {
+      int from = draw(nNodes), to = draw(nNodes);
+      if (draw(3) == 0 && !edges[from % edges.size()].empty()) { // deletes an edge that exists
+	from %= edges.size();
+	to = edges[from].begin()->first;
+	batch.push_back(EdgeUpdate<double>::deletion(from, to));
+      }
+      else if (draw(4) == 0) { batch.push_back(EdgeUpdate<double>::deletion(from, to)); }
+      else { batch.push_back(EdgeUpdate<double>::insertion(from, to, draw(10))); }
+
+      // The reference applies the same update in batch order
+      edges.resize(max(edges.size(), (size_t) max(from, to) + 1));
+      for (int half = 0; half < (directed ? 1 : 2); half++) {
+	int start = half ? to : from, end = half ? from : to;
+	if (batch.back().insert) { edges[start].insert(make_pair(end, batch.back().weight)); }
+	else {
+	  for (auto it = edges[start].begin(); it != edges[start].end(); ) {
+	    it = (it->first == end) ? edges[start].erase(it) : next(it);
+	  }
+	}
+      }
+    }
+
+    g.apply(batch);
+    checkView(*g.snapshot(), edges, "View after batch " + to_string(b));
+    checkView(*previous, previousEdges, "View before batch " + to_string(b));
+    checkView(*first, firstEdges, "First view after batch " + to_string(b));
+    previous = g.snapshot();
+    previousEdges = edges;
+  }
+}
+
+/*
+ * Checks the distances and paths kept by dynamic shortest paths against a
+ * fresh Dijkstra on the graph as it is now
+ */
+template <class Graph_T>
+void checkDynamicSSSP(const DynamicSSSP<double, Graph_T> &sssp, const string &step) {
+  const Graph_T &g = sssp.graph();
+  QueryContext<double> ctx(g.size());
+  Dijkstra(g, sssp.source(), ctx);
+
+  for (size_t id = 0; id < g.size(); id++) {
+    vector<int> path = sssp.path(id);
+    bool samePath = (ctx.distance(id) == Node<double>::INFINITY) ? path.empty() :
+      (!path.empty() && path.front() == sssp.source() && path.back() == (int) id &&
+       pathWeight(g, path) == ctx.distance(id));
+    if (sssp.distance(id) != ctx.distance(id) || !samePath) {
+      throw runtime_error("Dynamic shortest paths differ from Dijkstra from " + to_string(sssp.source()) +
+			  " to " + to_string(id) + " after " + step);
+    }
+  }
+}
+
+/*
+ * Changes a graph through dynamic shortest paths from src, checking them
+ * after every change: a shortcut that is then made longer, a node removed
+ * and added back, and finally the removal of the tree edge into every node
+ */
+template <class Graph_T>
+void checkDynamicUpdates(Graph_T &g, int src) {
+  const int n = g.size();
+  if (n < 3) { return; }
+  const int near = (src + 1) % n, middle = (src + n / 2) % n, far = (src + n - 1) % n;
+
+  DynamicSSSP<double, Graph_T> sssp(g, src);
+  checkDynamicSSSP(sssp, "construction");
+  sssp.addNode(far);
+  sssp.addEdge(src, far, 1);
+  checkDynamicSSSP(sssp, "adding a shortcut");
+  sssp.setWeight(src, far, 100);
+  checkDynamicSSSP(sssp, "making the shortcut longer");
+  sssp.addNode(middle);
+  sssp.addEdge(middle, far, 2);
+  checkDynamicSSSP(sssp, "adding an edge");
+  sssp.removeNode(middle);
+  checkDynamicSSSP(sssp, "removing a node");
+  sssp.addNode(middle);
+  sssp.addNode(near);
+  sssp.addEdge(src, middle, 3);
+  sssp.addEdge(middle, near, 1);
+  checkDynamicSSSP(sssp, "adding the node back");
+
+  for (int id = 0; id < n; id++) {
+    int parent = sssp.parent(id);
+    if (parent == -1 || parent == id) { continue; }
+    sssp.removeEdge(parent, id);
+    checkDynamicSSSP(sssp, "removing the tree edge into " + to_string(id));
+  }
+}
+
+/*
+ * Checks a point-to-point shortest path against the one from Dijkstra: the
+ * same distance, and a path from src to dest of that weight
+ */
+template <class Graph_T>
+void checkPath(const Graph_T &g, const Path<double> &expected, const Path<double> &path, int src, int dest,
+	       const string &algorithm) {
+  bool samePath = expected.nodes.empty() ? path.nodes.empty() :
+    (!path.nodes.empty() && path.nodes.front() == src && path.nodes.back() == dest &&
+     pathWeight(g, path.nodes) == expected.distance);
+  if (path.distance != expected.distance || !samePath) {
+    throw runtime_error(algorithm + " differs from Dijkstra from " + to_string(src) + " to " + to_string(dest));
+  }
+}
+
+/*
+ * Checks bidirectional Dijkstra, searching backward over reverse, and A*
+ * with a zero estimate against Dijkstra for every pair of nodes of a graph
+ * with non-negative weights
+ */
+template <class Graph_T, class Reverse_T>
+void checkPointToPoint(const Graph_T &g, const Reverse_T &reverse) {
+  QueryContext<double> ctx(g.size()), forward(g.size()), backward(g.size());
+  IndexedHeap<double> open(g.size());
+
+  for (size_t src = 0; src < g.size(); src++) {
+    for (size_t dest = 0; dest < g.size(); dest++) {
+      if (g.node(src) == nullptr || g.node(dest) == nullptr) { continue; }
+      Path<double> expected = Dijkstra(g, src, dest, ctx);
+      checkPath(g, expected, BidirectionalDijkstra(g, reverse, src, dest, forward, backward), src, dest,
+		"Bidirectional Dijkstra");
+      checkPath(g, expected, AStar(g, src, dest, [](int) { return 0.0; }, ctx, open), src, dest, "A*");
+    }
+  }
+}
+
+/*
+ * Checks the connected components of a directed graph and of its
+ * undirected version, sequential and parallel, and its strongly connected
+ * components against reachability by BFS
+ */
+template <class Graph_T, class Undirected_T>
+void checkComponents(const Graph_T &g, const Undirected_T &undirected, Components &weak, Components &strong) {
+  Components other;
+  ConnectedComponents(g, weak);
+  for (unsigned threads : { 1, 4 }) {
+    ParallelConnectedComponents(g, other, threads);
+    bool same = (other.component == weak.component && other.sizes == weak.sizes);
+    ParallelConnectedComponents(undirected, other, threads);
+    if (!same || other.component != weak.component || other.sizes != weak.sizes) {
+      throw runtime_error("Parallel connected components differ with " + to_string(threads) + " threads");
+    }
+  }
+  StronglyConnectedComponents(g, strong);
+
+  QueryContext<double> ctx(g.size());
+  for (size_t i = 0; i < g.size(); i++) {
+    for (size_t j = 0; j < g.size(); j++) {
+      if (g.node(i) == nullptr || g.node(j) == nullptr) { continue; }
+      if ((weak.component[i] == weak.component[j]) != reaches(undirected, i, j, ctx)) {
+	throw runtime_error("Connected components differ from BFS at " + to_string(i) + ", " + to_string(j));
+      }
+      if ((strong.component[i] == strong.component[j]) != (reaches(g, i, j, ctx) && reaches(g, j, i, ctx))) {
+	throw runtime_error("Strongly connected components differ from BFS at " + to_string(i) + ", " +
+			    to_string(j));
+      }
+    }
+  }
+}
+
+/*
+ * Checks that a cycle found by depth-first search follows edges of the
+ * graph, and that one is found exactly when topological sorting fails
+ */
+template <class Graph_T>
+void checkCycle(const Graph_T &g, const vector<int> &cycle) {
+  vector<int> closed(cycle);
+  if (!cycle.empty()) { closed.push_back(cycle.front()); }
+  if (pathWeight(g, closed) == Node<double>::INFINITY || (!g.isDirected() && cycle.size() == 2)) {
+    throw runtime_error("Cycle found by depth-first search does not follow the edges");
+  }
+  if (g.isDirected() && cycle.empty() != !hasCycle<double>(g)) {
+    throw runtime_error("Depth-first search and topological sort disagree on cycles");
+  }
+}
+
+/*
+ * Checks the articulation points of an undirected graph, given as edges in
+ * text form, against the number of components left after removing each node
+ */
+inline void checkArticulationPoints(const string &edges, const vector<int> &points) {
+  istringstream in(edges);
+  AdjacencyList<double> g(in, false);
+  Components before, after;
+  ConnectedComponents(g, before);
+
+  for (size_t id = 0; id < g.size(); id++) {
+    if (g.node(id) == nullptr) { continue; }
+    istringstream again(edges);
+    AdjacencyList<double> removed(again, false);
+    removed.removeNode(id);
+    ConnectedComponents(removed, after);
+    if ((after.count() > before.count()) != binary_search(points.begin(), points.end(), (int) id)) {
+      throw runtime_error("Articulation points differ at " + to_string(id));
+    }
+  }
+}
+
+/*
+ * Checks that Kruskal, Prim and Borůvka find minimum spanning forests of
+ * an undirected graph with the same weight and one edge fewer than the
+ * nodes of every component, and returns the one found by Kruskal
+ */
+template <class Graph_T>
+SpanningForest<double> checkSpanningForests(const Graph_T &g) {
+  Components c;
+  ConnectedComponents(g, c);
+  size_t nNodes = 0;
+  for (size_t size : c.sizes) { nNodes += size; }
+
+  SpanningForest<double> kruskal, other;
+  Kruskal(g, kruskal, 1);
+  for (int run = 0; run < 4; run++) {
+    switch (run) {
+    case 0: Kruskal(g, other, 4); break;
+    case 1: Prim(g, other); break;
+    case 2: Boruvka(g, other, 1); break;
+    default: Boruvka(g, other, 4); break;
+    }
+    if (other.weight != kruskal.weight || other.edges.size() != kruskal.edges.size()) {
+      throw runtime_error("Spanning forests differ in weight or size, run " + to_string(run));
+    }
+  }
+  if (kruskal.edges.size() != nNodes - c.count()) {
+    throw runtime_error("Spanning forest has " + to_string(kruskal.edges.size()) + " edges, not " +
+			to_string(nNodes - c.count()));
+  }
+  return kruskal;
+}
+
+/*
+ * Checks PageRank against power iteration with the dense transition
+ * matrix, in which a dangling node jumps like a teleport. The ranks must
+ * also sum to 1. An empty sources vector checks plain PageRank, otherwise
+ * personalized PageRank from the sources.
+ */
+template <class Graph_T>
+void checkPageRank(const Graph_T &g, const vector<int> &sources) {
+  const size_t n = g.size();
+  PageRankOptions options;
+  options.tolerance = 1e-12;
+  options.maxIterations = 1000;
+
+  PageRanks ranks;
+  if (sources.empty()) { PageRank(g, ranks, options); }
+  else { PersonalizedPageRank(g, sources, ranks, options); }
+
+  vector<double> teleport(n, 0.0);
+  size_t nNodes = 0;
+  for (size_t i = 0; i < n; i++) { nNodes += (g.node(i) != nullptr); }
+  for (size_t i = 0; i < n; i++) {
+    if (sources.empty() && g.node(i) != nullptr) { teleport[i] = 1.0 / nNodes; }
+  }
+  for (int id : sources) { teleport[id] += 1.0 / sources.size(); }
+
+  // transition[v][u] is the probability of moving from u to v
+  vector<vector<double> > transition(n, vector<double>(n, 0.0));
+  for (size_t u = 0; u < n; u++) {
+    if (g.node(u) == nullptr) { continue; }
+    size_t degree = g.outDegree(g.node(u));
+    for (auto& edge : g.adjacent(g.node(u))) { transition[edge->getEnd()->getID()][u] += 1.0 / degree; }
+    for (size_t v = 0; degree == 0 && v < n; v++) { transition[v][u] = teleport[v]; }
+  }
+
+  vector<double> rank(teleport), next(n);
+  for (int iteration = 0; iteration < 1000; iteration++) {
+    for (size_t v = 0; v < n; v++) {
+      next[v] = (1 - options.damping) * teleport[v];
+      for (size_t u = 0; u < n; u++) { next[v] += options.damping * transition[v][u] * rank[u]; }
+    }
+    rank.swap(next);
+  }
+
+  double sum = 0;
+  for (size_t v = 0; v < n; v++) {
+    sum += ranks.rank[v];
+    if (abs(ranks.rank[v] - rank[v]) > 1e-9) {
+      throw runtime_error("PageRank of " + to_string(v) + " differs from dense power iteration");
+    }
+  }
+  if (nNodes > 0 && abs(sum - 1) > 1e-9) { throw runtime_error("PageRanks sum to " + to_string(sum)); }
+}
+
+/*
+ * Runs every algorithm on the graph and prints the results
+ */
+template <class Graph_T>
+int runTests(const Graph_T &my_graph) {
   cout << fixed << setprecision(1);
   cout << "Graph from File:" << endl;
   cout << my_graph << endl;
   
-  (!hasCycle<double>(my_graph)) ? cout << "Graph is cyclic. " << endl : 
+  (hasCycle<double>(my_graph)) ? cout << "Graph is cyclic. " << endl : 
     cout << "Graph contains no cycles. " << endl;
+  dumpStats("TopologicalSort");
   
   cout << endl;
 
@@ -52,16 +909,19 @@ int main(int argc, char *argv[]) {
     cout << "1. Depth-first Search from Node 0: ";
     DFS_iterative(my_graph, my_graph.node(0), true);
     cout << endl;
+    dumpStats("DFS");
     
     cout << "2. Breadth-first Search from Node 0: ";
     BFS(my_graph, my_graph.node(0), true);
     cout << endl;
+    dumpStats("BFS");
 
     cout << endl;
 
     cout << "3. Minimum Distance from Node 0 to 5 (Bellman-Ford): "
 	 << BellmanFord(my_graph, my_graph.node(0), my_graph.node(5), true)
 	 << endl;
+    dumpStats("BellmanFord");
 
     cout << endl;
 
@@ -69,6 +929,7 @@ int main(int argc, char *argv[]) {
     
     vector<vector<double> > distances; 
     FloydWarshall(my_graph, distances);  
+    dumpStats("FloydWarshall");
     for (size_t i = 0; i < my_graph.size(); i++) {
       cout << i << ": ";
       for (size_t j = 0; j < my_graph.size(); j++) {
@@ -82,9 +943,157 @@ int main(int argc, char *argv[]) {
       cout << endl;
     }
 
+    cout << endl;
+
+    const string edges = absoluteEdges(my_graph); // same edges, weights made non-negative
+    istringstream positiveEdges(edges), undirectedEdges(edges);
+    AdjacencyList<double> positive(positiveEdges, true), undirected(undirectedEdges, false);
+
+    checkContractionHierarchy(positive);
+    cout << "5. Contraction Hierarchy against Dijkstra, all pairs with |weights|: OK" << endl;
+
+    checkMultiSourceBFS(my_graph);
+    cout << "6. Multi-source BFS against BFS from every node: OK" << endl;
+
+    Components weak, strong;
+    checkComponents(my_graph, undirected, weak, strong);
+    cout << "7. Components against BFS: " << weak.count() << " connected, "
+	 << strong.count() << " strongly connected" << endl;
+
+    vector<int> cycle = FindCycle(my_graph), points = ArticulationPoints(undirected);
+    checkCycle(my_graph, cycle);
+    checkCycle(undirected, FindCycle(undirected));
+    checkArticulationPoints(edges, points);
+    cout << "8. Cycle: ";
+    if (cycle.empty()) { cout << "none"; }
+    else { printOrder(cycle); }
+    cout << ", Articulation Points of the undirected graph: ";
+    if (points.empty()) { cout << "none"; }
+    else { printOrder(points); }
+    cout << endl;
+
+    SpanningForest<double> forest = checkSpanningForests(undirected);
+    cout << "9. Minimum Spanning Forest of the undirected graph (Kruskal, Prim, Boruvka): "
+	 << forest.edges.size() << " edges, weight " << forest.weight << endl;
+
+    checkPageRank(my_graph, vector<int>());
+    checkPageRank(my_graph, vector<int>(1, 0));
+    cout << "10. PageRank and personalized PageRank from Node 0 against dense power iteration: OK" << endl;
+
+    checkParallelBFS(my_graph);
+    checkParallelBFS(undirected);
+    cout << "11. Parallel BFS against BFS from every node: OK" << endl;
+
+    istringstream integerEdges(edges);
+    AdjacencyList<int> integer(integerEdges, true);
+    checkDeltaStepping(positive, vector<double>({ 0.001, 1, 7.5, 100 }));
+    checkDeltaStepping(integer, vector<int>({ 1, 7, 100 }));
+    cout << "12. Delta-stepping against Dijkstra with double and int weights: OK" << endl;
+
+    checkNegativeCycles(my_graph);
+    cout << "13. Negative-weight cycles closed on every shortest path: OK" << endl;
+
+    checkJohnson(my_graph, distances);
+    cout << "14. Johnson's matrix and lines against Floyd-Warshall: OK" << endl;
+
+    checkParallelTopologicalSort(my_graph);
+    cout << "15. Parallel topological sort and its layers against the edges: OK" << endl;
+
+    for (bool directed : { true, false }) {
+      istringstream listEdges(edges), matrixEdges(edges), lateEdges(edges);
+      AdjacencyList<double> list(listEdges, directed, true), late(lateEdges, directed);
+      AdjacencyMatrix<double> matrix(matrixEdges, directed, true);
+      late.addNode(0);
+      late.addEdge(0, 0, 1);
+      late.trackIncoming();
+      checkIncomingEdges(list);
+      checkIncomingEdges(late);
+      checkIncomingEdges(matrix);
+    }
+    cout << "16. Incoming edges and in-degrees against an edge scan, after every change: OK" << endl;
+
+    checkSnapshot(my_graph);
+    cout << "17. Snapshot round trip, and corrupt snapshots rejected without the checksum: OK" << endl;
+
+    for (bool directed : { true, false }) {
+      for (unsigned threads : { 1, 4 }) { checkStreamingGraph(directed, threads); }
+    }
+    cout << "18. Streaming graph views against replayed batches, older views unchanged: OK" << endl;
+
+    for (bool directed : { true, false }) {
+      for (size_t src = 0; src < positive.size(); src++) {
+	if (positive.node(src) == nullptr) { continue; }
+	istringstream listEdges(edges), matrixEdges(edges);
+	AdjacencyList<double> list(listEdges, directed);
+	AdjacencyMatrix<double> matrix(matrixEdges, directed);
+	checkDynamicUpdates(list, src);
+	checkDynamicUpdates(matrix, src);
+      }
+    }
+    cout << "19. Dynamic shortest paths against Dijkstra after every change: OK" << endl;
+
+    checkPointToPoint(positive, CSRGraph<double>(positive).transpose());
+    checkPointToPoint(undirected, undirected);
+    cout << "20. Bidirectional Dijkstra and A* against Dijkstra, all pairs with |weights|: OK" << endl;
+
   }
   catch (const exception &e) {
     cerr << e.what() << endl;
       return -1;
   }
+  return 0;
+}
+
+/*
+ * Tests the Adjacency List representation read from text, or the CSR
+ * representation mapped from a snapshot. Testing the Adjacency Matrix
+ * representation should theoretically be identical.
+ *
+ * -c converts a text graph to a snapshot instead of running the tests.
+ */
+int main(int argc, char *argv[]) {
+ 
+  ifstream f;
+  bool hasFile = false;
+
+  string usage = "Usage: " + string(argv[0]) + " [-f <filename> | -s <snapshot> | -c <filename> <snapshot>]";
+
+  if (argc > 1) {
+    string mode = argv[1];
+    if ((mode != "-f" && mode != "-s" && mode != "-c") || argc < (mode == "-c" ? 4 : 3)) {
+      cerr << usage << endl;
+      return -1;
+    }
+
+    try {
+      if (mode == "-s") {
+	return runTests(CSRGraph<double>::load(argv[2]));
+      }
+      if (mode == "-c") {
+	CSRGraph<double> g(EdgeReader<double>(string(argv[2])), true);
+	g.save(argv[3]);
+	cout << "Wrote " << g.size() << " nodes and " << g.numEdges() << " edges to " << argv[3] << endl;
+	return 0;
+      }
+    }
+    catch (const exception &e) {
+      cerr << e.what() << endl;
+      cerr << usage << endl;
+      return -1;
+    }
+    
+    f.open(argv[2]);
+    if (!f.good()) {
+      cerr << "Couldn't open file " << argv[2] << endl;
+      cerr << usage << endl;
+      return -1;
+    }
+    
+    hasFile = true;
+  }
+
+  istream &in = hasFile ? f : cin;
+  
+  auto my_graph = AdjacencyList<double>(in, true);
+  return runTests(my_graph);
 }